@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+// -------------------------------------------------------------
+// ヒープ確保の計数 (解析用)
+// CMake の CHESS_ALLOC_COUNTING=ON でビルドすると、グローバルな operator new を置き換えて
+// プロセス全体 (全スレッド) の確保回数とバイト数を数える。無効なビルドでは常に 0 を返す
+// 探索の前後で snapshot() の差を取れば、その探索での確保が分かる
+// 探索ノードの中 (negamax/quiescence の実行中) の確保は nodeAllocations() に別に数える
+// -------------------------------------------------------------
+#ifndef CHESS_ALLOC_COUNTING
+#define CHESS_ALLOC_COUNTING 0
+#endif
+constexpr bool ALLOC_COUNTING_ENABLED = CHESS_ALLOC_COUNTING != 0;
+
+struct AllocStats
+{
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+
+    AllocStats operator-(const AllocStats &other) const
+    {
+        return {allocations - other.allocations, bytes - other.bytes};
+    }
+};
+
+class AllocCounter
+{
+public:
+    // プログラム開始からの累計
+    static AllocStats snapshot();
+
+    // そのうち、いずれかのスレッドが探索ノードの中にいる間に行われた確保の回数
+    static uint64_t nodeAllocations();
+
+    // NodeAllocScope が使う (呼び出したスレッドの入れ子の深さ)
+    static void enterNode();
+    static void leaveNode();
+};
+
+// 探索ノードの区間 (negamax/quiescence の先頭に置く)。無効なビルドでは空になり、コストは無い
+class NodeAllocScope
+{
+public:
+    NodeAllocScope()
+    {
+        if constexpr (ALLOC_COUNTING_ENABLED)
+            AllocCounter::enterNode();
+    }
+
+    ~NodeAllocScope()
+    {
+        if constexpr (ALLOC_COUNTING_ENABLED)
+            AllocCounter::leaveNode();
+    }
+
+    NodeAllocScope(const NodeAllocScope &) = delete;
+    NodeAllocScope &operator=(const NodeAllocScope &) = delete;
+};
@@ -20,8 +20,20 @@
 #include <ctime>
 #include <cctype>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <thread>
 
 #include "types.hpp"
+#include "latency_histogram.hpp"
+#include "search_types.hpp"
+#include "search_handle.hpp"
+#include "transposition_table.hpp"
+#include "tree_log.hpp"
+#include "time_manager.hpp"
 
 class ChessGame
 {
@@ -43,7 +55,46 @@ public:
     std::vector<Move> generateMoves(bool white) const;
 
     // AI機能
-    Move bestMove(bool white);
+    Move bestMove(bool white); // setSearchLimits() の制限で search() を行い、最善手だけを返す
+
+    // search() の1回ごとの応答時間 (局面の段階ごと。bestMove()/searchAsync()/Ponderer も含む)
+    // ChessGame のコピーは同じ統計を共有する
+    const MoveLatencyStats &moveLatency() const;
+    void resetMoveLatency();
+    GamePhase gamePhase() const; // 現在の局面の段階 (序盤/中盤/終盤)
+
+    // 反復深化探索。limits.stop のコピーを持っておけば、別スレッドから停止できる
+    // (停止されても、その時点までの最善手を返す)
+    // onProgress は反復が完了するたびに呼ばれる
+    SearchResult search(bool white, const SearchLimits &limits,
+                        const SearchProgressCallback &onProgress = nullptr);
+
+    // 別スレッドで search() を開始してすぐに戻る。探索は現在の盤面のコピーで行うので、
+    // 探索中もこのオブジェクトを操作してよい (置換表は共有するので setHashSize() は不可)
+    // onFinished は結果が確定したときに探索スレッド上で呼ばれる
+    // 停止フラグは探索ごとに新しく作るので、止めるには limits.stop ではなく返り値の cancel() を使う
+    SearchHandle searchAsync(bool white, const SearchLimits &limits,
+                             SearchProgressCallback onProgress = nullptr,
+                             SearchFinishedCallback onFinished = nullptr) const;
+
+    // bestMove() が使う探索制限
+    void setSearchLimits(const SearchLimits &limits);
+    const SearchLimits &searchLimits() const;
+
+    // 選択的探索 (枝刈り/削減) の個別の有効/無効
+    void setSearchOptions(const SearchOptions &options);
+    const SearchOptions &searchOptions() const;
+
+    // 同点の手を選ぶ乱数の種 (既定では生成時刻)。同じ種なら同じ選び方になる
+    void setSeed(uint64_t seed);
+
+    // 探索スレッド数 (Lazy SMP)。1 ならシングルスレッド (1..MAX_SEARCH_THREADS に丸める)
+    void setThreads(int threads);
+    int threads() const;
+
+    // 探索木のログの出力先 (nullptr で無効, 所有はしない)。メインスレッドの探索だけを記録する
+    // ChessGame のコピーも同じログに書くので、ログが有効な間はコピーで同時に探索しないこと
+    void setTreeLog(TreeLog *log);
 
     // 終了判定
     bool isEnd(bool turnWhite);
@@ -62,6 +113,9 @@ public:
     // FENから盤面設定
     void initBoardWithStrings(const std::string rows[8]);
 
+    // FEN文字列から盤面設定 (手番は turnWhite に返す)。不正な形式なら false
+    bool initBoardWithFEN(const std::string &fen, bool &turnWhite);
+
     // FENから最善手
     Move getBestMoveFromBoard(const std::string rows[8], bool turnWhite);
 
@@ -71,35 +125,195 @@ public:
     bool algebraicToCoords(const std::string &alg, int &row, int &col) const;
 
     std::string getBoardStateFEN(bool turnWhite) const;
+    void writeBoardStateFEN(bool turnWhite, std::string &fen) const; // fen の領域を再利用する
 
     bool isPromotionMove(Move move);
 
+    // 静的交換評価: move のマスで取り合いを続けた場合の駒得 (手番側視点, センチポーン)
+    // 実際には手を指さず、X線 (後ろに並んだスライド駒) も考慮する
+    int see(const Move &move) const;
+
+    // 相手に取られると駒損になる white 側の駒のマス (探索なしで求める)
+    std::vector<std::pair<int, int>> hangingPieces(bool white) const;
+
+    // 置換表に残っているこの局面の最善手 (ポンダーの予想手に使う)。無ければ false
+    bool hashMove(bool white, Move &move) const;
+
+    // runGame での AI の持ち時間 (baseMs = 0 なら setSearchLimits() の深さで指す)
+    // movesPerControl > 0 なら、その手数ごとに baseMs が加算される
+    void setTimeControl(int64_t baseMs, int64_t incrementMs = 0, int movesPerControl = 0);
+
+    // 相手の手番中に先読みするか (runGame と GUI が参照する)
+    void setPonder(bool enabled);
+    bool ponder() const;
+
+    // 置換表の操作 (探索中でなければいつでも呼び出せる)
+    // ChessGame のコピーは同じ置換表を共有する
+    bool setHashSize(size_t megabytes); // 内容は消去される。失敗時は false
+    void clearHash();
+    size_t hashSizeMB() const;
+    bool hashUsesHugePages() const; // ヒュージページを取得できたか
+
 private:
+    // マイクロベンチマーク (micro_bench.cpp) が内部関数を直接計測するための窓口
+    friend struct ChessGameBenchAccess;
+
     // 状態をカプセル化 (グローバル変数の廃止)
     Piece board[8][8];
     CastlingRights castlingRights;
-    const int MAX_DEPTH = 4; // Minimaxの深さ
+    SearchLimits limits_; // bestMove() の探索制限 (深さの既定値は 4)
+    SearchOptions options_;
 
-    std::pair<int, int> enPassantSquare_; // アンパッサン可能なマス (無効な場合は {-1, -1} など)
+    std::pair<int, int> enPassantSquare_ = {-1, -1}; // アンパッサン可能なマス (無効な場合は {-1, -1} など)
     int halfMoveClock_ = 0;               // 半手数（50手ルール導入のため）
     int fullMoveNumber_ = 1;              // プレイされている手番の数 (黒番が終了するたびにインクリメント)
 
     std::vector<std::string> position_history_; // perprtual check判定用盤面履歴
+    mutable std::string fenBuffer_;              // 探索中の繰り返し判定で使い回すFEN
+    std::vector<std::string> spareFens_;         // ルートの手で取り除いた履歴の文字列 (領域を使い回す)
+
+    // 置換表とZobristキー (手番を含まない。手番は positionKey() で合成する)
+    std::shared_ptr<TranspositionTable> tt_;
+    uint64_t hashKey_ = 0;
+
+    std::shared_ptr<MoveLatencyStats> moveLatency_; // search() の応答時間
+
+    // Lazy SMP
+    int threads_ = 1;
+
+    // ヘルパーの ChessGame (探索のたびにコピーし直さず、prepareHelper() で局面だけ合わせて使い回す)
+    // ChessGame をコピーしてもヘルパーは引き継がない (コピー側で最初に探索するときに作る)
+    struct HelperGames
+    {
+        std::vector<std::unique_ptr<ChessGame>> games;
+
+        HelperGames() = default;
+        HelperGames(const HelperGames &) {}
+        HelperGames &operator=(const HelperGames &) { return *this; }
+    };
+    HelperGames helpers_;
+
+    bool ponder_ = true;
+
+    std::mt19937_64 rng_; // 同点の手の選択用
+
+    // runGame の持ち時間
+    int64_t clockBaseMs_ = 0;
+    int64_t clockIncrementMs_ = 0;
+    int clockMovesPerControl_ = 0;
+
+    // 探索の制御 (search() の実行中のみ有効)
+    std::atomic<bool> *stop_ = nullptr; // 停止フラグ (探索外では nullptr)
+    bool enforceLimits_ = false;        // このスレッドが制限を監視するか (メインスレッドのみ)
+    SearchLimits activeLimits_;
+    int rootDepth_ = 0; // 実行中の反復の深さ
+    bool pondering_ = false; // ponder hit 前の先読み中
+    int64_t ponderHitMs_ = 0; // ponder hit 時点の経過時間 (時間制限はここから数える)
+    std::chrono::steady_clock::time_point searchStart_;
+
+    // 毎ノード書き換えるスレッドごとのカウンタ。ヘルパーの ChessGame は unique_ptr でそれぞれ別に
+    // ヒープに確保される。alignas(64) でオブジェクト自体も 64 バイト境界に置かれるので、隣の確保
+    // (別のヘルパーなど) とキャッシュラインを共有せず、同じオブジェクトの共有されるメンバ
+    // (探索前に prepareHelper() がメインからコピーする盤面や制限) とも前後を区切られる
+    alignas(64) uint64_t nodes_ = 0;
+    SearchStats stats_;
+    alignas(64) TimeManager timeManager_;
+    uint64_t firstRootMoveNodes_ = 0; // 直前の反復でルートの最初の手 (前の最善手) に使ったノード数
+    std::atomic<uint64_t> *helperNodes_ = nullptr; // ヘルパーが途中経過用にノード数を加算する先
+
+    // 手順付け (スレッドごと)
+    static constexpr int MAX_PLY = 128;
+    uint16_t killers_[MAX_PLY][2] = {}; // ply ごとに beta カットを起こした静かな手 (packMove 形式)
+    int history_[2][64][64] = {};       // [手番][from][to] の butterfly history
+
+    // ply ごとの手と手順付けの値。探索中に確保しないよう、容量を残したまま使い回す
+    std::vector<Move> moveLists_[MAX_PLY];
+    std::vector<int> moveScoreLists_[MAX_PLY];
+
+    // 読み筋 (三角形 PV テーブル, packMove 形式)
+    uint16_t pvTable_[MAX_PLY][MAX_PLY] = {};
+    int pvLength_[MAX_PLY] = {};
+    uint16_t prevPv_[MAX_PLY] = {}; // 前の反復の最善の読み筋 (次の反復で最初に読む)
+    int prevPvLength_ = 0;
+    bool followPv_ = false;         // 前の反復の読み筋の上を読んでいる間 true
+
+    // searchRoot() の作業領域 (反復の間で容量を残したまま使い回す)
+    struct RootScratch
+    {
+        std::vector<int> scores;
+        std::vector<int> topScores;
+        std::vector<size_t> order;
+        std::vector<Move> moves;
+        std::vector<std::vector<uint16_t>> pvs;
+    };
+    RootScratch rootScratch_;
+
+    // 探索木のログ (setTreeLog() されたときだけ使う)
+    // 子ノードが自分の ply に結果を書き、親ノードが子の探索後にまとめて記録する
+    TreeLog *treeLog_ = nullptr;
+    int8_t treeCutoffIndex_[MAX_PLY] = {}; // beta カットを起こした手の位置 (-1 = カット無し)
+    uint8_t treeNodeFlags_[MAX_PLY] = {};  // TREE_TT_CUTOFF / TREE_NODE_PRUNED
 
     // ヘルパー関数
     std::pair<int, int> findKing(bool white) const;
     bool isKingOnBoard(bool white) const;
     bool isSquareAttacked(int r, int c, bool attackingWhite) const;
     void generateSlidingMoves(int r, int c, bool white, char type, std::vector<Move> &moves) const;
+    std::vector<Move> generateMoves(bool white, bool tacticalOnly) const;
+    void generateMoves(bool white, bool tacticalOnly, std::vector<Move> &moves) const;
+    bool isTactical(const Move &move) const;
+    bool hasNonPawnMaterial(bool white) const;
 
     bool isDrawByThreefoldRepetition(bool turnWhite) const;
+    bool hashMove(bool white, Move &move, std::vector<Move> &legal) const;
 
     // ★ makeMoveInternal / unmakeMoveInternal のシグネチャ変更 ★
     void makeMoveInternal(Move &m); // Undo情報を書き込むためにポインタ渡しする
     void unmakeMoveInternal(Move m);
+    void makeRootMove(Move &m, bool nextTurnWhite);
+    void undoRootMove(const Move &m);
     void updateCastlingRights(int r, int c);
 
-    // Minimax
+    // Zobristキー
+    uint64_t computeHashKey() const;
+    uint64_t positionKey(bool turnWhite) const;
+
+    // 探索
     int evaluate() const;
-    int minimax(int depth, bool isMaximizingPlayer, int alpha, int beta);
+    int negamax(int depth, int ply, bool white, int alpha, int beta, bool allowNull = true);
+    int searchChild(int depth, int ply, bool white, int alpha, int beta, const Move *move, size_t moveIndex,
+                    uint8_t flags, bool allowNull = true);
+    void logTreeNode(int depth, int ply, int alpha, int beta, int score, const Move *move, size_t moveIndex,
+                     uint8_t flags);
+    int quiescence(int ply, bool white, int alpha, int beta);
+    bool isLosingCapture(const Move &move) const;
+    bool leastValuableAttacker(int r, int c, bool side, uint64_t occupied, int &outR, int &outC) const;
+    void scoreMoves(const std::vector<Move> &moves, std::vector<int> &scores,
+                    uint16_t pvMove, uint16_t ttMove, int ply, bool white) const;
+    void updateQuietHeuristics(const Move &move, int depth, int ply, bool white);
+    void resetHeuristics();
+    bool searchRoot(bool white, int depth, std::vector<Move> &moves, std::vector<int> &rootScores,
+                    std::vector<std::vector<uint16_t>> &rootPvs,
+                    int &bestScore, std::vector<Move> &tiedMoves, int prevScore);
+    void collectLines(bool white, const std::vector<Move> &moves, const std::vector<int> &rootScores,
+                      const std::vector<std::vector<uint16_t>> &rootPvs, int depth,
+                      std::vector<SearchLine> &lines);
+    void unpackLine(bool white, const std::vector<uint16_t> &packed, int maxLength, std::vector<Move> &line);
+    void clearPv(int ply);
+    void updatePv(int ply, uint16_t move);
+    int searchAspiration(bool white, int depth, int prevScore, const Move &move);
+    void prepareHelper(const ChessGame &main);
+    void helperSearch(int helperId, bool white, std::vector<Move> moves);
+    void countNode();
+
+    // 統計カウンタの加算 (SEARCH_STATS_ENABLED が false なら何もしない)
+    void countStat(uint64_t SearchStats::*counter)
+    {
+        if constexpr (SEARCH_STATS_ENABLED)
+            ++(stats_.*counter);
+    }
+    void checkLimits();
+    void checkPonderHit();
+    int64_t elapsedMs() const;
+    bool isAborted() const { return stop_ && stop_->load(std::memory_order_relaxed); }
 };
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// -------------------------------------------------------------
+// 応答時間のヒストグラム (HDR 形式, マイクロ秒)
+// 2の冪ごとの区間を 32 等分したバケットに数えるので、1us から数日までを
+// 約3%の相対誤差で固定サイズのまま記録できる (平均ではなく p99 や最大を見るためのもの)
+// -------------------------------------------------------------
+class LatencyHistogram
+{
+public:
+    void record(int64_t us);
+    void reset();
+
+    uint64_t count() const { return count_; }
+    int64_t min() const { return count_ ? min_ : 0; }
+    int64_t max() const { return max_; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+
+    // percent (0-100) パーセンタイルの値。バケットの上端を返す (max を超えない)
+    int64_t percentile(double percent) const;
+
+    LatencyHistogram &operator+=(const LatencyHistogram &other);
+
+private:
+    static constexpr int SUB_BUCKET_BITS = 5; // 2の冪ごとのバケット数 = 32
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 40; // 2^40 us (約12日) まで
+    static constexpr int BUCKET_COUNT = 2 * SUB_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+    static int bucketIndex(uint64_t us);
+    static uint64_t bucketUpperBound(int index);
+
+    std::array<uint64_t, BUCKET_COUNT> counts_ = {};
+    uint64_t count_ = 0;
+    int64_t min_ = 0;
+    int64_t max_ = 0;
+    uint64_t sum_ = 0;
+};
+
+// -------------------------------------------------------------
+// 局面の段階 (応答時間の内訳に使う)
+// -------------------------------------------------------------
+enum GamePhase
+{
+    PHASE_OPENING = 0,
+    PHASE_MIDDLEGAME,
+    PHASE_ENDGAME,
+    PHASE_COUNT
+};
+
+const char *gamePhaseName(GamePhase phase);
+
+// -------------------------------------------------------------
+// 指し手の要求ごとの応答時間 (段階ごとのヒストグラムと、最も遅かった局面)
+// 探索スレッドと表示側から同時に使えるように、操作はロックで保護する
+// -------------------------------------------------------------
+class MoveLatencyStats
+{
+public:
+    void record(GamePhase phase, int64_t us, const std::string &fen);
+    void reset();
+
+    LatencyHistogram histogram(GamePhase phase) const;
+    LatencyHistogram total() const;
+
+    // 段階ごとに最も遅かった局面の FEN と時間 (記録が無ければ空文字列)
+    std::string slowestPosition(GamePhase phase, int64_t &us) const;
+
+    // 段階ごとの件数/p50/p90/p99/最大と、最も遅かった局面の表
+    std::string report() const;
+
+private:
+    mutable std::mutex mutex_;
+    LatencyHistogram histograms_[PHASE_COUNT];
+    int64_t slowestUs_[PHASE_COUNT] = {};
+    std::string slowestFen_[PHASE_COUNT];
+};
@@ -0,0 +1,212 @@
+#include "perf_counters.hpp"
+
+#if CHESS_PERF_COUNTERS
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const char *const EVENT_NAMES[PERF_EVENT_COUNT] = {"cycles", "instructions", "cache-misses", "branch-misses"};
+    const char *const PHASE_NAMES[PERF_PHASE_COUNT] = {"movegen", "eval", "tt probe"};
+
+#if CHESS_PERF_COUNTERS
+    const uint64_t EVENT_CONFIGS[PERF_EVENT_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+    };
+
+    // カウンタはスレッドごとの状態 (start() を呼んだスレッドだけが開いている)
+    struct ThreadCounters
+    {
+        int leader = -1;                      // グループの先頭の fd
+        int fds[PERF_EVENT_COUNT] = {-1, -1, -1, -1};
+        int slot[PERF_EVENT_COUNT] = {-1, -1, -1, -1}; // グループ読み出しでの位置 (-1 = 開けなかった)
+        int opened = 0;
+
+        int depth = 0;          // PerfScope の入れ子の深さ
+        PerfPhase current = PERF_MOVEGEN;
+        PerfSample enterSample; // 最も外側のフェーズに入ったときの値
+
+        PerfSample startSample;
+        PerfSample stopSample;
+        bool running = false;
+        PerfSample phases[PERF_PHASE_COUNT];
+    };
+
+    thread_local ThreadCounters counters;
+
+    // グループの全イベントを1回のシステムコールで読む
+    PerfSample readCounters()
+    {
+        PerfSample sample;
+        uint64_t buffer[1 + PERF_EVENT_COUNT] = {};
+        if (read(counters.leader, buffer, sizeof(buffer)) <= 0)
+            return sample;
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e)
+            if (counters.slot[e] >= 0 && static_cast<uint64_t>(counters.slot[e]) < buffer[0])
+                sample.values[e] = buffer[1 + counters.slot[e]];
+        return sample;
+    }
+
+    PerfSample difference(const PerfSample &to, const PerfSample &from)
+    {
+        PerfSample d;
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e)
+            d.values[e] = to.values[e] - from.values[e];
+        return d;
+    }
+
+    void closeCounters()
+    {
+        for (int &fd : counters.fds)
+        {
+            if (fd >= 0)
+                close(fd);
+            fd = -1;
+        }
+        counters.leader = -1;
+        counters.opened = 0;
+    }
+#endif
+}
+
+bool PerfCounters::start(std::string &error)
+{
+#if CHESS_PERF_COUNTERS
+    stop();
+    counters = ThreadCounters();
+
+    int firstErrno = 0;
+    for (int e = 0; e < PERF_EVENT_COUNT; ++e)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = EVENT_CONFIGS[e];
+        attr.disabled = counters.leader < 0 ? 1 : 0; // グループの先頭で全体を止めておく
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+
+        int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, counters.leader, 0));
+        if (fd < 0)
+        {
+            // 一部のイベントが無い PMU もあるので、開けたものだけで続ける
+            if (!firstErrno)
+                firstErrno = errno;
+            continue;
+        }
+        if (counters.leader < 0)
+            counters.leader = fd;
+        counters.fds[e] = fd;
+        counters.slot[e] = counters.opened++;
+    }
+
+    if (counters.leader < 0)
+    {
+        error = std::string("perf_event_open failed: ") + std::strerror(firstErrno);
+        if (firstErrno == EACCES || firstErrno == EPERM)
+            error += " (see /proc/sys/kernel/perf_event_paranoid)";
+        else if (firstErrno == ENOENT || firstErrno == EOPNOTSUPP)
+            error += " (no hardware PMU, e.g. inside a virtual machine)";
+        return false;
+    }
+
+    ioctl(counters.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(counters.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    counters.running = true;
+    counters.startSample = readCounters();
+    return true;
+#else
+    error = "not built with hardware counters (configure with -DCHESS_PERF_COUNTERS=ON on Linux)";
+    return false;
+#endif
+}
+
+void PerfCounters::stop()
+{
+#if CHESS_PERF_COUNTERS
+    if (!counters.running)
+        return;
+    counters.stopSample = readCounters();
+    counters.running = false;
+    closeCounters();
+#endif
+}
+
+bool PerfCounters::active()
+{
+#if CHESS_PERF_COUNTERS
+    return counters.running;
+#else
+    return false;
+#endif
+}
+
+bool PerfCounters::available(PerfEvent event)
+{
+#if CHESS_PERF_COUNTERS
+    return counters.slot[event] >= 0;
+#else
+    (void)event;
+    return false;
+#endif
+}
+
+PerfSample PerfCounters::total()
+{
+#if CHESS_PERF_COUNTERS
+    return difference(counters.running ? readCounters() : counters.stopSample, counters.startSample);
+#else
+    return PerfSample();
+#endif
+}
+
+PerfSample PerfCounters::phase(PerfPhase phase)
+{
+#if CHESS_PERF_COUNTERS
+    return counters.phases[phase];
+#else
+    (void)phase;
+    return PerfSample();
+#endif
+}
+
+const char *PerfCounters::eventName(PerfEvent event)
+{
+    return EVENT_NAMES[event];
+}
+
+const char *PerfCounters::phaseName(PerfPhase phase)
+{
+    return PHASE_NAMES[phase];
+}
+
+void PerfCounters::enter(PerfPhase phase)
+{
+#if CHESS_PERF_COUNTERS
+    if (counters.depth++ == 0 && counters.running)
+    {
+        counters.current = phase;
+        counters.enterSample = readCounters();
+    }
+#else
+    (void)phase;
+#endif
+}
+
+void PerfCounters::leave()
+{
+#if CHESS_PERF_COUNTERS
+    if (--counters.depth == 0 && counters.running)
+        counters.phases[counters.current] += difference(readCounters(), counters.enterSample);
+#endif
+}
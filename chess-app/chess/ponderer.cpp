@@ -0,0 +1,93 @@
+#include "ponderer.hpp"
+
+bool Ponderer::start(const ChessGame &game, bool engineWhite, const SearchLimits &limits,
+                     const std::vector<Move> &engineLine,
+                     SearchProgressCallback onProgress, SearchFinishedCallback onFinished)
+{
+    stop();
+
+    Move expected;
+    if (engineLine.size() >= 2 && game.isLegal(engineLine[1], !engineWhite))
+    {
+        expected = engineLine[1];
+    }
+    else if (!game.hashMove(!engineWhite, expected))
+    {
+        return false;
+    }
+
+    ChessGame position = game;
+    position.makeMove(expected);
+    expected_ = expected;
+
+    // ponder hit のフラグは呼び出し元と共有しない (停止フラグは searchAsync() が作る)
+    limits_ = limits;
+    limits_.ponder = true;
+    limits_.ponderHit = StopToken();
+
+    auto state = std::make_shared<State>();
+    state->onFinished = std::move(onFinished);
+    state_ = state;
+
+    handle_ = position.searchAsync(
+        engineWhite, limits_, std::move(onProgress),
+        [state](const SearchResult &result)
+        {
+            SearchFinishedCallback callback;
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->finished = true;
+                state->result = result;
+                if (state->hit)
+                    callback = state->onFinished;
+            }
+            if (callback)
+                callback(result);
+        });
+    return true;
+}
+
+bool Ponderer::opponentMoved(const Move &played)
+{
+    if (!active())
+    {
+        return false;
+    }
+    if (TranspositionTable::packMove(played) != TranspositionTable::packMove(expected_))
+    {
+        stop();
+        return false;
+    }
+
+    // 先読みが既に終わっていれば (上限の深さまで読み切った場合など)、ここで結果を渡す
+    SearchFinishedCallback callback;
+    SearchResult result;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->hit = true;
+        if (state_->finished)
+        {
+            callback = state_->onFinished;
+            result = state_->result;
+        }
+    }
+    limits_.ponderHit.request();
+    if (callback)
+    {
+        callback(result);
+    }
+    return true;
+}
+
+SearchResult Ponderer::wait()
+{
+    SearchResult result = handle_.get();
+    state_.reset();
+    return result;
+}
+
+void Ponderer::stop()
+{
+    handle_ = SearchHandle(); // 停止を要求して探索スレッドを回収する
+    state_.reset();
+}
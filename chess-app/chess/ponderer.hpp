@@ -0,0 +1,65 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include "chess_game.hpp"
+
+// -------------------------------------------------------------
+// 相手の手番中の先読み (ponder)
+// ・AI が指した直後に start() を呼ぶと、相手の予想手 (AI の読み筋の2手目) を指した局面で
+//   AI の次の手の探索を別スレッドで始める
+// ・相手が指したら opponentMoved() を呼ぶ。予想が当たれば (ponder hit) 探索を止めずに
+//   通常の探索に切り替えるので、それまでの反復・手順付け・置換表がそのまま使える。
+//   外れれば探索を止める (置換表に書いた内容は残る)
+// -------------------------------------------------------------
+class Ponderer
+{
+public:
+    /**
+     * @brief 先読みを始める (実行中の先読みは止める)
+     * @param game 相手の手番の局面 (コピーして使うので、呼び出し後も自由に操作してよい)
+     * @param engineWhite AI の手番
+     * @param limits ponder hit 後に適用する探索制限
+     * @param engineLine AI が指した手から始まる読み筋 (SearchResult::pv)。2手目を予想手にする
+     *                   (無い場合は置換表の最善手)
+     * @param onProgress 反復ごとの途中経過 (先読み中も呼ばれる)
+     * @param onFinished ponder hit 後に結果が確定したとき呼ばれる (外れた場合は呼ばれない)
+     * @return 予想手が無く、先読みを始めなかった場合は false
+     */
+    bool start(const ChessGame &game, bool engineWhite, const SearchLimits &limits,
+               const std::vector<Move> &engineLine = {},
+               SearchProgressCallback onProgress = nullptr,
+               SearchFinishedCallback onFinished = nullptr);
+
+    /**
+     * @brief 相手の手を通知する
+     * @return 予想手だった (ponder hit) なら true。結果は onFinished か wait() で受け取る
+     */
+    bool opponentMoved(const Move &played);
+
+    // ponder hit 後の結果を待つ
+    SearchResult wait();
+
+    // 先読みを止める
+    void stop();
+
+    bool active() const { return handle_.valid(); }
+    const Move &expectedMove() const { return expected_; }
+
+private:
+    // 探索スレッドと共有する状態 (hit と結果の確定の順序はどちらが先でもよい)
+    struct State
+    {
+        std::mutex mutex;
+        bool hit = false;
+        bool finished = false;
+        SearchResult result;
+        SearchFinishedCallback onFinished;
+    };
+
+    std::shared_ptr<State> state_;
+    SearchHandle handle_;
+    SearchLimits limits_;
+    Move expected_;
+};
@@ -0,0 +1,56 @@
+#include "search_handle.hpp"
+
+SearchHandle::SearchHandle(std::thread thread, std::future<SearchResult> result, StopToken stop)
+    : thread_(std::move(thread)), result_(std::move(result)), stop_(std::move(stop))
+{
+}
+
+SearchHandle::~SearchHandle()
+{
+    finish();
+}
+
+SearchHandle &SearchHandle::operator=(SearchHandle &&other) noexcept
+{
+    if (this != &other)
+    {
+        finish();
+        thread_ = std::move(other.thread_);
+        result_ = std::move(other.result_);
+        stop_ = std::move(other.stop_);
+    }
+    return *this;
+}
+
+void SearchHandle::cancel() const
+{
+    stop_.request();
+}
+
+bool SearchHandle::isReady() const
+{
+    return waitFor(std::chrono::milliseconds(0));
+}
+
+bool SearchHandle::waitFor(std::chrono::milliseconds timeout) const
+{
+    return result_.valid() && result_.wait_for(timeout) == std::future_status::ready;
+}
+
+SearchResult SearchHandle::get()
+{
+    SearchResult result = result_.get();
+    if (thread_.joinable())
+        thread_.join();
+    return result;
+}
+
+// 実行中の探索を止めて、スレッドを回収する
+void SearchHandle::finish()
+{
+    if (thread_.joinable())
+    {
+        stop_.request();
+        thread_.join();
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include "search_types.hpp"
+
+// -------------------------------------------------------------
+// 非同期探索のハンドル (ChessGame::searchAsync の返り値)
+// ・cancel() で停止を要求すると、探索はその時点までの最善手を結果として返す
+// ・破棄すると停止を要求し、探索スレッドの終了を待つ
+// -------------------------------------------------------------
+class SearchHandle
+{
+public:
+    SearchHandle() = default;
+    SearchHandle(std::thread thread, std::future<SearchResult> result, StopToken stop);
+    ~SearchHandle();
+
+    SearchHandle(SearchHandle &&other) noexcept = default;
+    SearchHandle &operator=(SearchHandle &&other) noexcept;
+    SearchHandle(const SearchHandle &) = delete;
+    SearchHandle &operator=(const SearchHandle &) = delete;
+
+    // 探索中 (または結果を受け取っていない) か
+    bool valid() const { return result_.valid(); }
+
+    // 停止を要求する (すぐに戻る。結果は get() で受け取る)
+    void cancel() const;
+
+    // 結果が出ているか
+    bool isReady() const;
+
+    // 指定時間だけ結果を待つ。結果が出たら true
+    bool waitFor(std::chrono::milliseconds timeout) const;
+
+    // 結果を受け取る (探索が終わるまで待つ)。1回だけ呼べる
+    SearchResult get();
+
+private:
+    std::thread thread_;
+    std::future<SearchResult> result_;
+    StopToken stop_;
+
+    void finish();
+};
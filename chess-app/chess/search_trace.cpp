@@ -0,0 +1,263 @@
+#include "search_trace.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+std::atomic<bool> SearchTrace::enabled_(false);
+
+namespace
+{
+    struct Event
+    {
+        int64_t timeUs = 0;
+        const char *name = nullptr;
+        char phase = 'i'; // 'B' 開始, 'E' 終了, 'i' 時点
+        TraceArg args[3];
+        char text[16] = {}; // 手の表記 (args の "move")
+    };
+
+    // スレッドごとのリングバッファ。スレッドが終わるとプールに戻り、次に始まったスレッドが使う
+    // (ヘルパーは探索ごとに作り直されるので、バッファが増え続けないように)
+    // 使い回すときは、前のスレッドのイベントを前の id と名前のまま退避してから空にする
+    struct ThreadBuffer
+    {
+        int id = 0;
+        std::string name;
+        std::vector<Event> events = std::vector<Event>(SearchTrace::EVENTS_PER_THREAD);
+        size_t next = 0;
+        bool wrapped = false;
+
+        size_t count() const { return wrapped ? events.size() : next; }
+        const Event &at(size_t i) const { return events[((wrapped ? next : 0) + i) % events.size()]; }
+    };
+
+    // 終了したスレッドのイベント (古い順)
+    struct FinishedThread
+    {
+        int id = 0;
+        std::string name;
+        std::vector<Event> events;
+
+        size_t count() const { return events.size(); }
+        const Event &at(size_t i) const { return events[i]; }
+    };
+
+    // 退避しておくイベントの上限 (超えたら古いスレッドから捨てる)
+    constexpr size_t MAX_FINISHED_EVENTS = SearchTrace::EVENTS_PER_THREAD * 16;
+
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers; // 全てのバッファ (書き出し用)
+    std::vector<ThreadBuffer *> idleBuffers;             // 使われていないバッファ
+    std::vector<FinishedThread> finishedThreads;         // バッファを使い回したスレッドのイベント
+    size_t finishedEvents = 0;
+    int lastThreadId = 0;
+
+    const std::chrono::steady_clock::time_point traceEpoch = std::chrono::steady_clock::now();
+
+    struct ThreadSlot
+    {
+        ThreadBuffer *buffer = nullptr;
+
+        ~ThreadSlot()
+        {
+            if (buffer)
+            {
+                std::lock_guard<std::mutex> lock(registryMutex);
+                idleBuffers.push_back(buffer);
+            }
+        }
+    };
+
+    thread_local ThreadSlot threadSlot;
+
+    // 前のスレッドのイベントを退避する (registryMutex を取った状態で呼ぶ)
+    void retireBuffer(ThreadBuffer &buffer)
+    {
+        if (buffer.count() == 0)
+            return;
+
+        FinishedThread finished;
+        finished.id = buffer.id;
+        finished.name = buffer.name;
+        finished.events.reserve(buffer.count());
+        for (size_t i = 0; i < buffer.count(); ++i)
+            finished.events.push_back(buffer.at(i));
+        finishedEvents += finished.events.size();
+        finishedThreads.push_back(std::move(finished));
+
+        while (finishedEvents > MAX_FINISHED_EVENTS)
+        {
+            finishedEvents -= finishedThreads.front().events.size();
+            finishedThreads.erase(finishedThreads.begin());
+        }
+    }
+
+    ThreadBuffer &threadBuffer()
+    {
+        if (!threadSlot.buffer)
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            ThreadBuffer *buffer;
+            if (!idleBuffers.empty())
+            {
+                buffer = idleBuffers.back();
+                idleBuffers.pop_back();
+                retireBuffer(*buffer);
+                buffer->next = 0;
+                buffer->wrapped = false;
+            }
+            else
+            {
+                buffers.push_back(std::make_unique<ThreadBuffer>());
+                buffer = buffers.back().get();
+            }
+            // スレッドごとに新しい id を振る
+            buffer->id = ++lastThreadId;
+            buffer->name = "thread " + std::to_string(buffer->id);
+            threadSlot.buffer = buffer;
+        }
+        return *threadSlot.buffer;
+    }
+
+    // JSON 文字列のエスケープ
+    void writeString(std::ostringstream &os, const char *s)
+    {
+        os << '"';
+        for (; *s; ++s)
+        {
+            if (*s == '"' || *s == '\\')
+                os << '\\';
+            os << *s;
+        }
+        os << '"';
+    }
+
+    // 1スレッド分のイベント (スレッド名のメタデータと、古いイベントから順に)
+    template <typename Thread>
+    void writeThread(std::ostringstream &os, const Thread &thread, bool &first)
+    {
+        os << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.id
+           << ",\"args\":{\"name\":";
+        writeString(os, thread.name.c_str());
+        os << "}}";
+        first = false;
+
+        for (size_t i = 0; i < thread.count(); ++i)
+        {
+            const Event &e = thread.at(i);
+            os << ",\n{\"name\":";
+            writeString(os, e.name);
+            os << ",\"ph\":\"" << e.phase << "\",\"ts\":" << e.timeUs << ",\"pid\":1,\"tid\":" << thread.id;
+            if (e.phase == 'i')
+                os << ",\"s\":\"t\"";
+
+            os << ",\"args\":{";
+            bool firstArg = true;
+            for (const TraceArg &arg : e.args)
+            {
+                if (!arg.name)
+                    continue;
+                os << (firstArg ? "" : ",");
+                writeString(os, arg.name);
+                os << ":" << arg.value;
+                firstArg = false;
+            }
+            if (e.text[0])
+            {
+                os << (firstArg ? "" : ",") << "\"move\":";
+                writeString(os, e.text);
+            }
+            os << "}}";
+        }
+    }
+}
+
+void SearchTrace::clear()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto &buffer : buffers)
+    {
+        buffer->next = 0;
+        buffer->wrapped = false;
+    }
+    finishedThreads.clear();
+    finishedEvents = 0;
+}
+
+void SearchTrace::setThreadName(const std::string &name)
+{
+    if (enabled())
+        threadBuffer().name = name;
+}
+
+void SearchTrace::begin(const char *name, TraceArg a, TraceArg b, TraceArg c)
+{
+    if (enabled())
+        record('B', name, a, b, c, nullptr);
+}
+
+void SearchTrace::end(const char *name, TraceArg a, TraceArg b, TraceArg c)
+{
+    if (enabled())
+        record('E', name, a, b, c, nullptr);
+}
+
+void SearchTrace::instant(const char *name, TraceArg a, TraceArg b, TraceArg c, const char *move)
+{
+    if (enabled())
+        record('i', name, a, b, c, move);
+}
+
+void SearchTrace::record(char phase, const char *name, TraceArg a, TraceArg b, TraceArg c, const char *text)
+{
+    ThreadBuffer &buffer = threadBuffer();
+    Event &e = buffer.events[buffer.next];
+    e.timeUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now() - traceEpoch)
+                   .count();
+    e.name = name;
+    e.phase = phase;
+    e.args[0] = a;
+    e.args[1] = b;
+    e.args[2] = c;
+    e.text[0] = '\0';
+    if (text)
+    {
+        std::strncpy(e.text, text, sizeof(e.text) - 1);
+        e.text[sizeof(e.text) - 1] = '\0';
+    }
+
+    if (++buffer.next == buffer.events.size())
+    {
+        buffer.next = 0;
+        buffer.wrapped = true;
+    }
+}
+
+std::string SearchTrace::chromeJson()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::ostringstream os;
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const FinishedThread &thread : finishedThreads)
+        writeThread(os, thread, first);
+    for (const auto &buffer : buffers)
+        writeThread(os, *buffer, first);
+    os << "\n]}\n";
+    return os.str();
+}
+
+bool SearchTrace::writeChromeJson(const std::string &path)
+{
+    std::ofstream out(path);
+    if (!out)
+        return false;
+    out << chromeJson();
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,64 @@
+#include "search_types.hpp"
+
+#include <cctype>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+    // 座標表記 (例: e2e4, e7e8q)
+    std::string moveToCoordinates(const Move &m)
+    {
+        if (m.from.first < 0 || m.to.first < 0)
+            return "";
+        std::string s;
+        s += static_cast<char>('a' + m.from.second);
+        s += static_cast<char>('8' - m.from.first);
+        s += static_cast<char>('a' + m.to.second);
+        s += static_cast<char>('8' - m.to.first);
+        if (m.promotedTo != '*')
+            s += static_cast<char>(std::tolower(m.promotedTo));
+        return s;
+    }
+}
+
+std::string searchResultToJson(const SearchResult &result)
+{
+    const SearchStats &st = result.stats;
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3);
+    os << "{\"bestMove\":\"" << moveToCoordinates(result.bestMove) << "\""
+       << ",\"score\":" << result.score
+       << ",\"depth\":" << result.depth
+       << ",\"nodes\":" << result.nodes
+       << ",\"qnodes\":" << st.quiescenceNodes
+       << ",\"timeMs\":" << result.timeMs
+       << ",\"stopped\":" << (result.stopped ? "true" : "false")
+       << ",\"statsEnabled\":" << (SEARCH_STATS_ENABLED ? "true" : "false")
+       << ",\"betaCutoffs\":" << st.betaCutoffs
+       << ",\"firstMoveCutoffs\":" << st.firstMoveCutoffs
+       << ",\"firstMoveCutoffRate\":" << st.firstMoveCutoffRate()
+       << ",\"ttProbes\":" << st.ttProbes
+       << ",\"ttHits\":" << st.ttHits
+       << ",\"ttHitRate\":" << st.ttHitRate()
+       << ",\"nullMoveTries\":" << st.nullMoveTries
+       << ",\"nullMoveCutoffs\":" << st.nullMoveCutoffs
+       << ",\"lmrReductions\":" << st.lmrReductions
+       << ",\"lmrResearches\":" << st.lmrResearches
+       << ",\"futilityPrunes\":" << st.futilityPrunes
+       << ",\"reverseFutilityPrunes\":" << st.reverseFutilityPrunes
+       << ",\"aspirationFailLows\":" << st.aspirationFailLows
+       << ",\"aspirationFailHighs\":" << st.aspirationFailHighs
+       << ",\"iterations\":[";
+    for (size_t i = 0; i < st.iterations.size(); ++i)
+    {
+        const IterationStats &it = st.iterations[i];
+        os << (i ? "," : "")
+           << "{\"depth\":" << it.depth
+           << ",\"nodes\":" << it.nodes
+           << ",\"timeMs\":" << it.timeMs
+           << ",\"ebf\":" << it.branching << "}";
+    }
+    os << "]}";
+    return os.str();
+}
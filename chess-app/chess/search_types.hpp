@@ -0,0 +1,208 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "types.hpp"
+
+// -------------------------------------------------------------
+// 探索の停止要求 (協調的キャンセル)
+// コピーは同じフラグを共有するので、search() に渡したトークンのコピーを持っておけば
+// 別スレッドから request() で止められる。探索は一定ノードごとにフラグを確認し、
+// その時点までの最善手を返す
+// (searchAsync() と bestMove() は探索ごとに新しいトークンを使う。止めるのは SearchHandle::cancel())
+// ムーブされた後のトークンはフラグを持たず、request() は何もせず requested() は false を返す
+// -------------------------------------------------------------
+class StopToken
+{
+public:
+    StopToken() : flag_(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void request() const
+    {
+        if (flag_)
+            flag_->store(true, std::memory_order_relaxed);
+    }
+    bool requested() const { return flag_ && flag_->load(std::memory_order_relaxed); }
+    void reset() const
+    {
+        if (flag_)
+            flag_->store(false, std::memory_order_relaxed);
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag_;
+};
+
+// 反復深化の深さの上限 (SearchLimits::depth = 0 のとき。これより深い指定もここで止まる)
+constexpr int MAX_SEARCH_DEPTH = 64;
+
+// 探索スレッド数の上限 (ChessGame::setThreads はこの範囲に丸める)
+constexpr int MAX_SEARCH_THREADS = 256;
+
+// -------------------------------------------------------------
+// 探索の制限 (どれか1つに達したら反復深化を打ち切る)
+// 0 は「制限なし」を表す。nodes と timeMs は反復の途中でも探索を止めるハードリミットだが、
+// 深さ1の反復は必ず完了させる (stop による停止だけは深さ1の途中でも効く)
+// -------------------------------------------------------------
+struct SearchLimits
+{
+    int depth = 4;       // 最大深さ (従来の MAX_DEPTH)
+    uint64_t nodes = 0;  // メインスレッドの最大ノード数
+    int64_t timeMs = 0;  // 思考時間の上限 (ミリ秒)
+    StopToken stop;      // 外部からの停止要求 (search() だけが使う。上の説明を参照)
+
+    // 持ち時間 (対局時計)。remainingMs > 0 なら TimeManager が1手の思考時間を決める
+    // (depth/nodes/timeMs も指定されていれば、先に達したほうで止まる)
+    int64_t remainingMs = 0; // 手番側の残り時間
+    int64_t incrementMs = 0; // 1手ごとの加算時間
+    int movesToGo = 0;       // 次の時間加算までの手数 (0 = 残り時間で最後まで指す)
+
+    // 相手の手番中の先読み (ponder)。ponderHit が request() されるまでは stop 以外の制限を
+    // 適用せずに読み続け、予想手が指されたら通常の探索に切り替わる (時間はそこから数える)
+    bool ponder = false;
+    StopToken ponderHit; // 停止ではなく、ponder hit の通知に使う
+};
+
+// -------------------------------------------------------------
+// 選択的探索の有効/無効 (効果を個別に測定するため実行時に切り替えられる)
+// -------------------------------------------------------------
+struct SearchOptions
+{
+    bool nullMovePruning = true;        // 適応的ヌルムーブ枝刈り
+    bool lateMoveReductions = true;     // 後ろの静かな手の深さ削減 (LMR)
+    bool futilityPruning = true;        // 末端付近の静かな手の枝刈り
+    bool reverseFutilityPruning = true; // 静的評価による fail-high
+    int aspirationWindow = 25;          // ルートのアスピレーションウィンドウの初期半幅 (0 で無効)
+    int multiPV = 1;                    // 正確な評価値と読み筋を求めるルートの手の数 (解析用)
+
+    // 決定的モード (性能比較用): 同点の手は乱数でなく手順の先頭を選び、探索ごとに置換表と
+    // history を消去する。スレッド数1なら同じ局面・同じ制限 (時間制限以外) で結果とノード数が
+    // 一致する。複数スレッドでは置換表の共有のタイミングでノード数が揺れる
+    bool deterministic = false;
+};
+
+// -------------------------------------------------------------
+// 探索統計のカウンタを有効にするか (CMake の CHESS_SEARCH_STATS で切り替える)
+// 無効なビルドでは、毎ノードのカウンタの加算がコンパイル時に消える。
+// 反復ごとの統計とアスピレーションの再探索回数 (時間管理が使う) は常に数える
+// -------------------------------------------------------------
+#ifndef CHESS_SEARCH_STATS
+#define CHESS_SEARCH_STATS 1
+#endif
+constexpr bool SEARCH_STATS_ENABLED = CHESS_SEARCH_STATS != 0;
+
+// -------------------------------------------------------------
+// 反復ごとの統計 (メインスレッドの値)
+// -------------------------------------------------------------
+struct IterationStats
+{
+    int depth = 0;
+    uint64_t nodes = 0;     // この反復で読んだノード数
+    int64_t timeMs = 0;     // 探索開始から反復の完了までの時間
+    double branching = 0.0; // 実効分岐係数: この反復と1つ前の反復のノード数の比 (深さ1は 0)
+};
+
+// -------------------------------------------------------------
+// 探索統計 (全スレッドの合計)
+// SEARCH_STATS_ENABLED が false のビルドでは、aspiration* と iterations 以外は 0 のまま
+// -------------------------------------------------------------
+struct SearchStats
+{
+    uint64_t quiescenceNodes = 0;  // 静止探索のノード数 (SearchResult::nodes の内数)
+    uint64_t ttProbes = 0;         // 置換表を引いた回数 (静止探索を除く)
+    uint64_t ttHits = 0;           // そのうちエントリが見つかった回数
+    uint64_t betaCutoffs = 0;      // beta カットが起きたノード数
+    uint64_t firstMoveCutoffs = 0; // そのうち最初の手でカットしたノード数
+    uint64_t nullMoveTries = 0;
+    uint64_t nullMoveCutoffs = 0;
+    uint64_t lmrReductions = 0;         // 削減して読んだ手
+    uint64_t lmrResearches = 0;         // そのうち alpha を超えて読み直した手
+    uint64_t futilityPrunes = 0;
+    uint64_t reverseFutilityPrunes = 0;
+    uint64_t aspirationFailLows = 0;    // アスピレーションウィンドウの再探索回数 (下側)
+    uint64_t aspirationFailHighs = 0;   // 同 (上側)
+
+    // 完了した反復ごとの値 (メインスレッドのみ。operator+= では合算しない)
+    std::vector<IterationStats> iterations;
+
+    // 手順付けの質の指標: 1.0 に近いほど良い
+    double firstMoveCutoffRate() const
+    {
+        return betaCutoffs ? static_cast<double>(firstMoveCutoffs) / betaCutoffs : 0.0;
+    }
+
+    double ttHitRate() const
+    {
+        return ttProbes ? static_cast<double>(ttHits) / ttProbes : 0.0;
+    }
+
+    SearchStats &operator+=(const SearchStats &other)
+    {
+        quiescenceNodes += other.quiescenceNodes;
+        ttProbes += other.ttProbes;
+        ttHits += other.ttHits;
+        betaCutoffs += other.betaCutoffs;
+        firstMoveCutoffs += other.firstMoveCutoffs;
+        nullMoveTries += other.nullMoveTries;
+        nullMoveCutoffs += other.nullMoveCutoffs;
+        lmrReductions += other.lmrReductions;
+        lmrResearches += other.lmrResearches;
+        futilityPrunes += other.futilityPrunes;
+        reverseFutilityPrunes += other.reverseFutilityPrunes;
+        aspirationFailLows += other.aspirationFailLows;
+        aspirationFailHighs += other.aspirationFailHighs;
+        return *this;
+    }
+};
+
+// -------------------------------------------------------------
+// 読み筋 (Multi-PV では評価順に SearchOptions::multiPV 本)
+// -------------------------------------------------------------
+struct SearchLine
+{
+    int score = 0;        // 白視点の評価値
+    std::vector<Move> pv; // 先頭がルートの手
+};
+
+// -------------------------------------------------------------
+// 探索結果 (最後に完了した反復の値)
+// 打ち切られた反復で読み終えた手を採用した場合は、bestMove/score/pv/lines[0] がその反復の値になる
+// -------------------------------------------------------------
+struct SearchResult
+{
+    Move bestMove;
+    int score = 0;      // 白視点の評価値
+    int depth = 0;      // 完了した反復の深さ
+    uint64_t nodes = 0; // 全スレッドの合計ノード数
+    int64_t timeMs = 0; // 経過時間 (ミリ秒)
+    bool stopped = false; // 停止要求または制限で反復の途中で打ち切られたか
+    SearchStats stats;
+    std::vector<Move> pv;          // bestMove から始まる読み筋
+    std::vector<SearchLine> lines; // 最後に完了した反復の上位の手 (評価順。lines[0] は bestMove と同じ)
+};
+
+// 探索結果の深さ・ノード数・時間と統計を1行の JSON オブジェクトにする (ログや解析用)
+std::string searchResultToJson(const SearchResult &result);
+
+// -------------------------------------------------------------
+// 反復ごとの途中経過 (進捗コールバックに渡される)
+// -------------------------------------------------------------
+struct SearchInfo
+{
+    int depth = 0;      // 完了した反復の深さ
+    int score = 0;      // 白視点の評価値
+    uint64_t nodes = 0; // 全スレッドの合計ノード数 (ヘルパー分は概算)
+    uint64_t nps = 0;   // 1秒あたりのノード数
+    int64_t timeMs = 0;
+    std::vector<Move> pv; // 読み筋 (先頭が最善手)
+    std::vector<SearchLine> lines; // Multi-PV の全ての読み筋 (lines[0].pv == pv)
+};
+
+// コールバックは探索スレッド上で呼ばれる。GUI から使う場合は UI スレッドへ受け渡すこと
+using SearchProgressCallback = std::function<void(const SearchInfo &)>;
+using SearchFinishedCallback = std::function<void(const SearchResult &)>;
@@ -0,0 +1,90 @@
+#include "time_manager.hpp"
+#include "search_trace.hpp"
+
+#include <algorithm>
+
+namespace
+{
+    const int64_t MOVE_OVERHEAD_MS = 30;   // 通信や盤面の更新で失う時間の見込み
+    const int DEFAULT_MOVES_TO_GO = 30;    // 切れ負けのとき、残りの手数をこれだけと見込む
+    const int MAX_MOVES_TO_GO = 50;
+    const int64_t HARD_LIMIT_FACTOR = 4;   // ハードリミット = ソフトリミットのこの倍まで
+    const int FAIL_LOW_MARGIN = 30;        // 前の反復からこれ以上下がったら fail-low とみなす
+    const int DOMINANT_STABLE_ITERATIONS = 4;
+    const double DOMINANT_EFFORT = 0.85;
+}
+
+void TimeManager::init(const SearchLimits &limits, size_t legalMoves)
+{
+    *this = TimeManager();
+    if (limits.remainingMs <= 0)
+    {
+        return;
+    }
+    active_ = true;
+    singleMove_ = legalMoves == 1;
+
+    int64_t available = std::max<int64_t>(1, limits.remainingMs - MOVE_OVERHEAD_MS);
+    int movesToGo = limits.movesToGo > 0 ? std::min(limits.movesToGo, MAX_MOVES_TO_GO) : DEFAULT_MOVES_TO_GO;
+
+    // 次の時間加算までの手数で均等に割り、加算時間の大部分を上乗せする
+    softMs_ = available / movesToGo + limits.incrementMs * 3 / 4;
+
+    // 1手で使い切らないように上限を設ける (時間加算の直前の手だけは、ほぼ全部使ってよい)
+    int64_t cap = movesToGo == 1 ? available * 9 / 10 : available / 2;
+    softMs_ = std::max<int64_t>(1, std::min(softMs_, cap));
+    hardMs_ = std::max<int64_t>(1, std::min(softMs_ * HARD_LIMIT_FACTOR, cap));
+    SearchTrace::instant("time allocation", {"softMs", softMs_}, {"hardMs", hardMs_},
+                         {"legalMoves", static_cast<int64_t>(legalMoves)});
+}
+
+bool TimeManager::iterationDone(int64_t elapsedMs, uint16_t bestMove, int score, bool failedLow,
+                                double bestMoveEffort)
+{
+    if (!active_)
+    {
+        return false;
+    }
+    iterations_++;
+
+    // 合法手が1つなら読む必要はない
+    if (singleMove_)
+    {
+        scale_ = 0.0;
+        SearchTrace::instant("time check", {"elapsedMs", elapsedMs}, {"limitMs", 0}, {"stop", 1});
+        return true;
+    }
+
+    // 最善手の変化を数える (古い変化ほど影響を小さくする)
+    instability_ *= 0.5;
+    if (iterations_ > 1 && bestMove != lastBestMove_)
+    {
+        instability_ += 1.0;
+        stableIterations_ = 0;
+    }
+    else
+    {
+        stableIterations_++;
+    }
+
+    scale_ = 1.0 + instability_ * 0.5;
+
+    // 評価値が下がった: 悪い手を指しそうなので読みを延ばす
+    if (failedLow || (iterations_ > 1 && score <= lastScore_ - FAIL_LOW_MARGIN))
+    {
+        scale_ *= 1.5;
+    }
+
+    // 1手が支配的: 最善手が何回も変わらず、ノードの大半をその手に使っている
+    if (stableIterations_ >= DOMINANT_STABLE_ITERATIONS && bestMoveEffort >= DOMINANT_EFFORT)
+    {
+        scale_ *= 0.5;
+    }
+
+    lastBestMove_ = bestMove;
+    lastScore_ = score;
+
+    int64_t limit = std::min(hardMs_, static_cast<int64_t>(softMs_ * scale_));
+    SearchTrace::instant("time check", {"elapsedMs", elapsedMs}, {"limitMs", limit}, {"stop", elapsedMs >= limit});
+    return elapsedMs >= limit;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+// -------------------------------------------------------------
+// 探索木のログ (解析用, 1ノード1レコードのバイナリ)
+// ・手順付けや枝刈りを勘ではなく実際の探索木から調整するためのもの (集計は chess_treelog)
+// ・ChessGame::setTreeLog() で渡したときだけ、メインスレッドの negamax の子ノードを1つずつ記録する
+//   (ヘルパースレッドと静止探索の内部は記録しない)。渡さなければ子ノードごとの分岐1つだけ
+// ・ファイルは TreeLogHeader の後に TreeLogRecord が並ぶ (書いたマシンのバイト順)
+// -------------------------------------------------------------
+
+enum TreeLogFlag : uint8_t
+{
+    TREE_REDUCED = 1 << 0,             // LMR で浅く読んだ
+    TREE_LMR_RESEARCH = 1 << 1,        // LMR で alpha を超えたので元の深さで読み直した
+    TREE_PVS_RESEARCH = 1 << 2,        // ヌルウィンドウで alpha を超えたので全幅で読み直した
+    TREE_ASPIRATION_RESEARCH = 1 << 3, // ルートの最初の手を広げた窓で読み直した
+    TREE_PRUNED = 1 << 4,              // フューティリティ枝刈りで読まなかった (score は無効)
+    TREE_NODE_PRUNED = 1 << 5,         // 子ノードがリバースフューティリティ/ヌルムーブで打ち切った
+    TREE_TT_CUTOFF = 1 << 6,           // 子ノードが置換表の値で打ち切った
+    TREE_NULL_MOVE = 1 << 7            // ヌルムーブの探索 (move = 0)
+};
+
+// 子ノード1つ分。窓と値は子ノードの手番側から見た値 (親から見ると符号が逆)
+struct TreeLogRecord
+{
+    int32_t alpha;
+    int32_t beta;
+    int32_t score;
+    uint16_t move;      // packMove() 形式 (ヌルムーブは 0)
+    uint8_t ply;        // 子ノードの ply (ルートの子が 1)
+    int8_t depth;       // 子ノードの残り深さ (0 以下なら静止探索に入った)
+    uint8_t moveIndex;  // 親ノードでの手順の位置 (255 以上は 255)
+    int8_t cutoffIndex; // 子ノードで beta カットを起こした手の位置 (-1 = カット無し, 127 以上は 127)
+    uint8_t flags;      // TreeLogFlag の組み合わせ
+    uint8_t rootDepth;  // 反復深化の深さ
+};
+static_assert(sizeof(TreeLogRecord) == 20, "TreeLogRecord is written to disk as is");
+
+struct TreeLogHeader
+{
+    static constexpr uint32_t MAGIC = 0x474c5443; // "CTLG"
+    static constexpr uint32_t VERSION = 1;
+
+    uint32_t magic = MAGIC;
+    uint32_t version = VERSION;
+    uint32_t recordSize = sizeof(TreeLogRecord);
+};
+
+// -------------------------------------------------------------
+// 書き込み (探索中に確保しないよう、バッファは open() で確保する)
+// -------------------------------------------------------------
+class TreeLog
+{
+public:
+    TreeLog() = default;
+    ~TreeLog();
+
+    TreeLog(const TreeLog &) = delete;
+    TreeLog &operator=(const TreeLog &) = delete;
+
+    // ヘッダを書いて記録を始める。失敗時は error に理由を返す
+    bool open(const std::string &path, std::string &error);
+
+    // 残りを書き出して閉じる。途中で書き込みに失敗していたら false
+    bool close();
+
+    bool isOpen() const { return file_ != nullptr; }
+    uint64_t records() const { return records_; }
+
+    void write(const TreeLogRecord &record)
+    {
+        buffer_[buffered_++] = record;
+        records_++;
+        if (buffered_ == BUFFER_RECORDS)
+            flush();
+    }
+
+private:
+    static constexpr size_t BUFFER_RECORDS = 4096;
+
+    void flush();
+
+    std::FILE *file_ = nullptr;
+    std::unique_ptr<TreeLogRecord[]> buffer_;
+    size_t buffered_ = 0;
+    uint64_t records_ = 0;
+    bool failed_ = false;
+};
+
+// -------------------------------------------------------------
+// 読み込み (先頭から1レコードずつ)
+// -------------------------------------------------------------
+class TreeLogReader
+{
+public:
+    TreeLogReader() = default;
+    ~TreeLogReader();
+
+    TreeLogReader(const TreeLogReader &) = delete;
+    TreeLogReader &operator=(const TreeLogReader &) = delete;
+
+    // ヘッダを確認する。形式が違えば error に理由を返す
+    bool open(const std::string &path, std::string &error);
+
+    // 次のレコード。ファイルの終わり (または途中で切れたレコード) なら false
+    bool next(TreeLogRecord &record);
+
+private:
+    std::FILE *file_ = nullptr;
+};
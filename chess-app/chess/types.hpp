@@ -8,6 +8,7 @@
 #include <ctime>
 #include <cctype>
 #include <algorithm>
+#include <cstdint>
 
 // CastlingRights 構造体を chess_game.hpp から移動
 struct CastlingRights
@@ -59,6 +60,7 @@ struct Move
     std::pair<int, int> oldEnPassantSquare = {-1, -1}; // 移動前のアンパッサンマス
     int oldHalfMoveClock = 0;                          // 移動前の50手ルールカウンター
     int oldFullMoveNumber = 1;                         // 移動前のフルムーブ数
+    uint64_t oldHashKey = 0;                           // 移動前のZobristキー
 
     // デフォルトコンストラクタ
     Move() = default;
@@ -74,10 +76,8 @@ struct Move
         // Undo情報はMoveの同一性に関わらないため、比較しない
         return from == other.from &&
                to == other.to &&
-               promotedTo == other.promotedTo &&
-            //
-            //    isEnPassant == other.isEnPassant &&
-            //    isCastling == other.isCastling
-            ;
+               promotedTo == other.promotedTo;
+        //    isEnPassant == other.isEnPassant &&
+        //    isCastling == other.isCastling
     }
 };
\ No newline at end of file
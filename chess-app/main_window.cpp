@@ -4,12 +4,17 @@
 #include <QVBoxLayout>
 #include <QMessageBox>
 #include <QDebug>
+#include <QLoggingCategory>
 #include "chess/chess_game.hpp"          // ChessGame
 #include "widget/chess_board_widget.hpp" // ChessBoardWidget
 #include <QFile>
 #include <QInputDialog>
 #include <QMessageBox>
 
+// クリックや FEN などのデバッグ出力は既定では出さず、対局終了時の応答時間の表 (info) だけを出す
+// (QT_LOGGING_RULES="chess.mainwindow.debug=true" でデバッグ出力も有効になる)
+Q_LOGGING_CATEGORY(lcMainWindow, "chess.mainwindow", QtInfoMsg)
+
 // コンストラクタ
 MainWindow::MainWindow(ChessGame *game, QWidget *parent)
     // m_fd の代わりに m_serialManager を初期化
@@ -21,6 +26,13 @@ MainWindow::MainWindow(ChessGame *game, QWidget *parent)
     m_boardWidget->setBoardFromFEN(m_game->getBoardStateFEN(false));
 }
 
+MainWindow::~MainWindow()
+{
+    // 探索スレッドがこのウィンドウへ通知する前に止めて回収する
+    m_ponderer.stop();
+    m_aiSearch = SearchHandle();
+}
+
 // UI要素の構築とスタイルの設定
 void MainWindow::setupUI()
 {
@@ -79,7 +91,7 @@ void MainWindow::setupConnections()
 
 void MainWindow::handleSquareClick(const QString &algebraicCoord)
 {
-    qDebug() << "クリックされました:" << algebraicCoord;
+    qCDebug(lcMainWindow) << "クリックされました:" << algebraicCoord;
     if (m_turnWhite)
     {
 
@@ -146,7 +158,7 @@ void MainWindow::handleSquareClick(const QString &algebraicCoord)
 
             if (islegal)
             { // 人間 (白) の手実行前
-                qDebug() << "Before Human Move FEN:" << m_game->getBoardStateFEN(m_turnWhite);
+                qCDebug(lcMainWindow) << "Before Human Move FEN:" << m_game->getBoardStateFEN(m_turnWhite);
                 m_game->makeMove(determinedMove);
                 m_turnWhite = !m_turnWhite;
 
@@ -159,48 +171,29 @@ void MainWindow::handleSquareClick(const QString &algebraicCoord)
                     emit updateLegalMoves({});
                     currentLegalMoves = {};
                     s_selectedSquare.clear(); // 選択解除
+                    m_ponderer.stop();
+                    logMoveLatency();
                     QMessageBox::information(this, tr("You win"), tr("you are good chess player"));
                 }
-
-                std::cout << "AI (Black) is thinking...\n";
-
-                // AI (黒) の手実行前
-                qDebug() << "Before AI Move FEN:" << m_game->getBoardStateFEN(m_turnWhite);
-
-                Move aiMove = m_game->bestMove(m_turnWhite);
-                m_game->makeMove(aiMove);
-                m_turnWhite = !m_turnWhite;
-
-                if (m_game->isEnd(m_turnWhite))
+                else if (m_ponderer.opponentMoved(determinedMove))
                 {
-                    // 移動後の盤面更新と、合法手リストのリセット
-                    m_boardWidget->setBoardFromFEN(m_game->getBoardStateFEN(false));
-
-                    // 合法手リストを空にして、強調表示を消す
-                    emit updateLegalMoves({});
-                    currentLegalMoves = {};
-                    s_selectedSquare.clear(); // 選択解除
-                    QMessageBox::information(this, tr("You lose"), tr("monkey"));
+                    // 予想どおりの手: 先読み中の探索が AI の手を返す
+                    qCDebug(lcMainWindow) << "AI (Black) ponder hit";
+                }
+                else
+                {
+                    startAiSearch();
                 }
-
-                // AI (黒) の手実行後
-                qDebug() << "After AI Move FEN:" << m_game->getBoardStateFEN(m_turnWhite);
             }
 
-            // 移動後の盤面更新と、合法手リストのリセット
-            m_boardWidget->setBoardFromFEN(m_game->getBoardStateFEN(false));
-
-            // 合法手リストを空にして、強調表示を消す
-            emit updateLegalMoves({});
-            currentLegalMoves = {};
-            s_selectedSquare.clear(); // 選択解除
+            refreshBoard();
         }
         // 2. 駒が選択されていない場合 (1回目のクリック)
         else
         {
             // 選択されたマスに駒があるかどうかのチェックも必要ですが、ここではスキップ
             s_selectedSquare = algebraicCoord;
-            qDebug() << "駒を選択:" << s_selectedSquare;
+            qCDebug(lcMainWindow) << "駒を選択:" << s_selectedSquare;
 
             int r;
             int c;
@@ -219,10 +212,103 @@ void MainWindow::handleSquareClick(const QString &algebraicCoord)
             if (coords.empty())
                 s_selectedSquare.clear(); // 選択解除
 
-            qDebug() << "合法ムーブ" << coords;
+            qCDebug(lcMainWindow) << "合法ムーブ" << coords;
 
             // 合法手リストをBoardWidgetに送信して描画させる
             emit updateLegalMoves(coords);
         }
     }
 }
+
+// AI の探索を開始する
+void MainWindow::startAiSearch()
+{
+    m_label->setText(tr("AI is thinking..."));
+
+    // AI (黒) の手実行前
+    qCDebug(lcMainWindow) << "Before AI Move FEN:" << m_game->getBoardStateFEN(m_turnWhite);
+
+    m_aiSearch = m_game->searchAsync(m_turnWhite, m_game->searchLimits(), progressCallback(), finishedCallback());
+}
+
+void MainWindow::startPondering(const std::vector<Move> &aiLine)
+{
+    if (m_game->ponder())
+    {
+        m_ponderer.start(*m_game, !m_turnWhite, m_game->searchLimits(), aiLine,
+                         progressCallback(), finishedCallback());
+    }
+}
+
+// 進捗と結果は探索スレッドから届くので、QueuedConnection で UI スレッドに渡す
+SearchProgressCallback MainWindow::progressCallback()
+{
+    return [this](const SearchInfo &info)
+    {
+        QMetaObject::invokeMethod(this, [this, info]()
+                                  {
+            QString pv;
+            for (const Move &m : info.pv)
+                pv += " " + QString::fromStdString(m_game->moveToAlgebratic(m));
+            m_label->setText(tr("depth %1  score %2\nnodes %3  nps %4\npv%5")
+                                 .arg(info.depth)
+                                 .arg(info.score)
+                                 .arg(info.nodes)
+                                 .arg(info.nps)
+                                 .arg(pv)); }, Qt::QueuedConnection);
+    };
+}
+
+SearchFinishedCallback MainWindow::finishedCallback()
+{
+    return [this](const SearchResult &result)
+    {
+        QMetaObject::invokeMethod(this, [this, result]()
+                                  { applyAiMove(result); }, Qt::QueuedConnection);
+    };
+}
+
+void MainWindow::applyAiMove(const SearchResult &result)
+{
+    // 探索スレッドを回収する
+    if (m_aiSearch.valid())
+        m_aiSearch.get();
+    m_ponderer.stop();
+
+    Move move = result.bestMove;
+    m_game->makeMove(move);
+    m_turnWhite = !m_turnWhite;
+
+    // AI (黒) の手実行後
+    qCDebug(lcMainWindow) << "After AI Move FEN:" << m_game->getBoardStateFEN(m_turnWhite);
+
+    refreshBoard();
+
+    if (m_game->isEnd(m_turnWhite))
+    {
+        logMoveLatency();
+        QMessageBox::information(this, tr("You lose"), tr("monkey"));
+    }
+    else
+    {
+        startPondering(result.pv);
+    }
+}
+
+void MainWindow::refreshBoard()
+{
+    // 移動後の盤面更新と、合法手リストのリセット
+    m_boardWidget->setBoardFromFEN(m_game->getBoardStateFEN(false));
+
+    // 合法手リストを空にして、強調表示を消す
+    emit updateLegalMoves({});
+    currentLegalMoves = {};
+    s_selectedSquare.clear(); // 選択解除
+}
+
+// 対局中の AI の手ごとの応答時間 (局面の段階ごとの p50/p90/p99/最大) をログに出す
+void MainWindow::logMoveLatency()
+{
+    qCInfo(lcMainWindow).noquote() << "AI move latency\n"
+                                   << QString::fromStdString(m_game->moveLatency().report());
+}
@@ -8,6 +8,8 @@
 #include <vector>
 #include <utility>
 #include "chess/types.hpp"
+#include "chess/search_handle.hpp"
+#include "chess/ponderer.hpp"
 
 class ChessGame;
 class ChessBoardWidget;
@@ -20,7 +22,7 @@ Q_OBJECT // Qt のメタオブジェクトシステムを有効にする
     public :
     // コンストラクタ: ChessGameとSerialManagerのポインタを受け取る
     explicit MainWindow(ChessGame *game, QWidget *parent = nullptr);
-    ~MainWindow() override = default;
+    ~MainWindow() override;
 
 private slots:
     /**
@@ -47,7 +49,40 @@ private:
 
     std::vector<Move> currentLegalMoves;
 
+    // AI (黒) の非同期探索。思考中も UI は応答する
+    SearchHandle m_aiSearch;
+
+    // ユーザーの手番中の先読み (予想手が指されれば、すぐに AI の手が返る)
+    Ponderer m_ponderer;
+
     void setupUI();
 
+    /**
+     * @brief AI の探索を別スレッドで開始する (結果は applyAiMove() で UI スレッドに渡る)
+     */
+    void startAiSearch();
+
+    /**
+     * @brief AI が指した後、ユーザーの予想手に対する AI の応手を裏で読み始める
+     * @param aiLine AI が指した手から始まる読み筋 (2手目が予想手になる)
+     */
+    void startPondering(const std::vector<Move> &aiLine);
+
+    // 探索スレッドからの通知を UI スレッドに渡すコールバック
+    SearchProgressCallback progressCallback();
+    SearchFinishedCallback finishedCallback();
+
+    /**
+     * @brief AI の手を盤面に適用する (UI スレッドで呼ぶこと)
+     * @param result 探索結果 (最善手と読み筋)
+     */
+    void applyAiMove(const SearchResult &result);
+
+    // 盤面表示の更新と、選択/合法手表示のリセット
+    void refreshBoard();
+
+    // 対局が終わったときに、AI の応答時間の表 (ChessGame::moveLatency()) をログに出す
+    void logMoveLatency();
+
     void setupConnections();
 };
\ No newline at end of file
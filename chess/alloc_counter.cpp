@@ -0,0 +1,121 @@
+#include "alloc_counter.hpp"
+
+#if CHESS_ALLOC_COUNTING
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<uint64_t> allocationCount(0);
+    std::atomic<uint64_t> allocatedBytes(0);
+    std::atomic<uint64_t> nodeAllocationCount(0);
+
+    thread_local int nodeDepth = 0; // このスレッドの探索ノードの入れ子の深さ
+
+    void *countedAlloc(std::size_t size, std::size_t alignment)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        if (nodeDepth > 0)
+            nodeAllocationCount.fetch_add(1, std::memory_order_relaxed);
+        if (size == 0)
+            size = 1;
+        void *p;
+        if (alignment <= alignof(std::max_align_t))
+        {
+            p = std::malloc(size);
+        }
+        else
+        {
+            // aligned_alloc はサイズがアラインメントの倍数である必要がある
+            p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+        }
+        return p;
+    }
+}
+
+// 置き換え可能なグローバル operator new/delete (例外版・nothrow 版・アラインメント指定版)
+void *operator new(std::size_t size)
+{
+    if (void *p = countedAlloc(size, 0))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    if (void *p = countedAlloc(size, 0))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (void *p = countedAlloc(size, static_cast<std::size_t>(alignment)))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    if (void *p = countedAlloc(size, static_cast<std::size_t>(alignment)))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAlloc(size, 0);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAlloc(size, 0);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { std::free(p); }
+
+AllocStats AllocCounter::snapshot()
+{
+    return {allocationCount.load(std::memory_order_relaxed), allocatedBytes.load(std::memory_order_relaxed)};
+}
+
+uint64_t AllocCounter::nodeAllocations()
+{
+    return nodeAllocationCount.load(std::memory_order_relaxed);
+}
+
+void AllocCounter::enterNode()
+{
+    nodeDepth++;
+}
+
+void AllocCounter::leaveNode()
+{
+    nodeDepth--;
+}
+#else
+AllocStats AllocCounter::snapshot()
+{
+    return AllocStats();
+}
+
+uint64_t AllocCounter::nodeAllocations()
+{
+    return 0;
+}
+
+void AllocCounter::enterNode() {}
+void AllocCounter::leaveNode() {}
+#endif
@@ -0,0 +1,286 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "alloc_counter.hpp"
+#include "chess_game.hpp"
+#include "perf_counters.hpp"
+#include "search_trace.hpp"
+#include "tree_log.hpp"
+
+namespace
+{
+    // 序盤・中盤・終盤から選んだ局面 (FEN)
+    const std::vector<std::string> BENCH_POSITIONS = {
+        // 序盤
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "rnbqkbnr/pp1ppppp/8/2p5/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2",
+        "r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R b KQkq - 3 3",
+        "rnbqkb1r/ppp2ppp/4pn2/3p4/2PP4/2N5/PP2PPPP/R1BQKBNR w KQkq - 2 4",
+        // 中盤
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 8",
+        "2rq1rk1/pp1bppbp/2np1np1/8/3NP3/1BN1BP2/PPPQ2PP/2KR3R b - - 0 11",
+        "r2q1rk1/pp2ppbp/2p2np1/6B1/3PP1b1/Q1P2N2/P4PPP/3RKB1R b K - 0 13",
+        // 終盤
+        "8/5k2/8/3R4/8/3K4/5P2/r7 w - - 0 1",
+        "8/k7/3p4/p2P1p2/P2P1P2/8/8/K7 w - - 0 1",
+        "8/8/3k4/8/8/4Q3/5K2/1q6 w - - 0 1",
+        "8/3k4/2n5/8/2B1P3/5K2/8/8 w - - 0 1",
+    };
+
+    // フェーズごとのハードウェアカウンタの表 (開けなかったイベントは n/a)
+    void printPerfRow(std::ostream &out, const std::string &name, const PerfSample &sample, uint64_t totalCycles)
+    {
+        out << std::left << std::setw(16) << name << std::right;
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e)
+        {
+            out << std::setw(16);
+            if (PerfCounters::available(static_cast<PerfEvent>(e)))
+                out << sample.values[e];
+            else
+                out << "n/a";
+        }
+
+        const uint64_t *v = sample.values;
+        out << std::fixed << std::setprecision(2);
+        if (PerfCounters::available(PERF_CYCLES) && PerfCounters::available(PERF_INSTRUCTIONS) && v[PERF_CYCLES])
+            out << std::setw(8) << static_cast<double>(v[PERF_INSTRUCTIONS]) / v[PERF_CYCLES];
+        else
+            out << std::setw(8) << "n/a";
+        if (PerfCounters::available(PERF_CYCLES) && totalCycles)
+            out << std::setw(9) << 100.0 * v[PERF_CYCLES] / totalCycles << "%";
+        out << "\n";
+        out.unsetf(std::ios::floatfield);
+    }
+
+    void printPerfReport(std::ostream &out)
+    {
+        PerfSample total = PerfCounters::total();
+        out << "---------------------------\n"
+            << "Hardware counters (main thread, user space)\n"
+            << std::left << std::setw(16) << "phase" << std::right;
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e)
+            out << std::setw(16) << PerfCounters::eventName(static_cast<PerfEvent>(e));
+        out << std::setw(8) << "IPC" << std::setw(10) << "share" << "\n";
+
+        PerfSample other = total;
+        for (int p = 0; p < PERF_PHASE_COUNT; ++p)
+        {
+            PerfSample sample = PerfCounters::phase(static_cast<PerfPhase>(p));
+            printPerfRow(out, PerfCounters::phaseName(static_cast<PerfPhase>(p)), sample, total.values[PERF_CYCLES]);
+            for (int e = 0; e < PERF_EVENT_COUNT; ++e)
+                other.values[e] -= std::min(other.values[e], sample.values[e]);
+        }
+        printPerfRow(out, "other", other, total.values[PERF_CYCLES]);
+        printPerfRow(out, "total", total, total.values[PERF_CYCLES]);
+    }
+
+    // JSON 形式の最後の行 (全局面の集計)
+    std::string summaryToJson(int depth, int threads, size_t hashMB, int64_t totalMs, uint64_t totalNodes,
+                              const AllocStats &allocs, const SearchStats &stats,
+                              const std::vector<int64_t> &depthMs, const std::vector<uint64_t> &depthNodes,
+                              const MoveLatencyStats &latency)
+    {
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(3);
+        os << "{\"summary\":{\"depth\":" << depth
+           << ",\"threads\":" << threads
+           << ",\"hashMB\":" << hashMB
+           << ",\"timeMs\":" << totalMs
+           << ",\"nodes\":" << totalNodes
+           << ",\"signatureReproducible\":" << (threads == 1 ? "true" : "false")
+           << ",\"nps\":" << totalNodes * 1000 / static_cast<uint64_t>(totalMs > 0 ? totalMs : 1)
+           << ",\"statsEnabled\":" << (SEARCH_STATS_ENABLED ? "true" : "false")
+           << ",\"firstMoveCutoffRate\":" << stats.firstMoveCutoffRate()
+           << ",\"ttHitRate\":" << stats.ttHitRate();
+        if (ALLOC_COUNTING_ENABLED)
+            os << ",\"allocations\":" << allocs.allocations << ",\"allocatedBytes\":" << allocs.bytes;
+
+        os << ",\"timeToDepth\":[";
+        for (int d = 1; d <= depth; ++d)
+            os << (d > 1 ? "," : "") << "{\"depth\":" << d << ",\"timeMs\":" << depthMs[d]
+               << ",\"nodes\":" << depthNodes[d] << "}";
+
+        os << "],\"latency\":{";
+        for (int p = 0; p < PHASE_COUNT; ++p)
+        {
+            LatencyHistogram h = latency.histogram(static_cast<GamePhase>(p));
+            os << (p ? "," : "") << "\"" << gamePhaseName(static_cast<GamePhase>(p)) << "\":{\"count\":" << h.count()
+               << ",\"p50Ms\":" << h.percentile(50) / 1000.0
+               << ",\"p90Ms\":" << h.percentile(90) / 1000.0
+               << ",\"p99Ms\":" << h.percentile(99) / 1000.0
+               << ",\"maxMs\":" << h.max() / 1000.0 << "}";
+        }
+        os << "}}}";
+        return os.str();
+    }
+}
+
+const std::vector<std::string> &benchPositions()
+{
+    return BENCH_POSITIONS;
+}
+
+int runBench(int depth, int threads, size_t hashMB, bool json, const std::string &tracePath, bool perf,
+             const std::string &treeLogPath)
+{
+    // 置換表の確保から記録する
+    SearchTrace::setEnabled(!tracePath.empty());
+    SearchTrace::clear();
+
+    ChessGame game;
+    game.setThreads(threads);
+    if (!game.setHashSize(hashMB))
+    {
+        std::cerr << "Failed to allocate " << hashMB << " MB hash\n";
+        return 1;
+    }
+
+    // 同じ入力から常に同じノード数になるよう、決定的モードで探索する
+    SearchOptions options = game.searchOptions();
+    options.deterministic = true;
+    game.setSearchOptions(options);
+
+    SearchLimits limits;
+    limits.depth = depth;
+
+    TreeLog treeLog;
+    if (!treeLogPath.empty())
+    {
+        std::string error;
+        if (!treeLog.open(treeLogPath, error))
+        {
+            std::cerr << "Failed to open tree log: " << error << "\n";
+            return 1;
+        }
+        game.setTreeLog(&treeLog);
+    }
+
+    // 計測できなくてもベンチマーク自体は続ける
+    if (perf)
+    {
+        std::string error;
+        if (!PerfCounters::start(error))
+        {
+            std::cerr << "Hardware counters unavailable: " << error << "\n";
+            perf = false;
+        }
+    }
+
+    uint64_t totalNodes = 0;
+    int64_t totalMs = 0;
+    SearchStats totalStats;
+    AllocStats totalAllocs;
+    // 局面の段階ごとの1局面あたりの探索時間 (search() が記録する)
+    game.resetMoveLatency();
+    const MoveLatencyStats &latency = game.moveLatency();
+    // 深さごとの到達時間とノード数 (全局面の合計)。スレッド数を変えて比べると Lazy SMP の効果が分かる
+    std::vector<int64_t> depthMs(depth + 1, 0);
+    std::vector<uint64_t> depthNodes(depth + 1, 0);
+    auto onProgress = [&](const SearchInfo &info)
+    {
+        if (info.depth <= depth)
+        {
+            depthMs[info.depth] += info.timeMs;
+            depthNodes[info.depth] += info.nodes;
+        }
+    };
+    for (size_t i = 0; i < BENCH_POSITIONS.size(); ++i)
+    {
+        bool white = true;
+        if (!game.initBoardWithFEN(BENCH_POSITIONS[i], white))
+        {
+            std::cerr << "Invalid bench position: " << BENCH_POSITIONS[i] << "\n";
+            return 1;
+        }
+
+        AllocStats allocsBefore = AllocCounter::snapshot();
+        auto start = std::chrono::steady_clock::now();
+        SearchResult result = game.search(white, limits, onProgress);
+        int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+        totalMs += us / 1000;
+        AllocStats allocs = AllocCounter::snapshot() - allocsBefore;
+        totalAllocs.allocations += allocs.allocations;
+        totalAllocs.bytes += allocs.bytes;
+        totalNodes += result.nodes;
+        totalStats += result.stats;
+
+        if (json)
+        {
+            std::cout << "{\"position\":" << i + 1 << ",\"fen\":\"" << BENCH_POSITIONS[i]
+                      << "\",\"result\":" << searchResultToJson(result) << "}\n";
+            continue;
+        }
+        std::cout << "Position " << i + 1 << "/" << BENCH_POSITIONS.size() << ": " << BENCH_POSITIONS[i] << "\n"
+                  << "  best " << game.moveToAlgebratic(result.bestMove) << " score " << result.score
+                  << " nodes " << result.nodes << "\n";
+    }
+
+    if (perf)
+        PerfCounters::stop();
+
+    // JSON 形式では標準出力を JSON の行だけにする (最後に全体の集計を1行で出し、表は標準エラーへ)
+    if (json)
+        std::cout << summaryToJson(depth, threads, hashMB, totalMs, totalNodes, totalAllocs, totalStats,
+                                   depthMs, depthNodes, latency)
+                  << "\n";
+    std::ostream &out = json ? std::cerr : std::cout;
+
+    out << "===========================\n"
+        << "Depth           : " << depth << "\n"
+        << "Threads         : " << threads << "\n"
+        << "Hash (MB)       : " << hashMB << "\n"
+        << "Total time (ms) : " << totalMs << "\n"
+        << "Nodes searched  : " << totalNodes
+        << (threads == 1 ? "" : " (not a signature: varies between runs with 2+ threads)") << "\n"
+        << "Nodes/second    : " << totalNodes * 1000 / static_cast<uint64_t>(totalMs > 0 ? totalMs : 1) << "\n";
+    if (ALLOC_COUNTING_ENABLED)
+    {
+        double nodes = static_cast<double>(totalNodes > 0 ? totalNodes : 1);
+        out << "Allocations     : " << totalAllocs.allocations << " (" << totalAllocs.allocations / nodes
+            << " per node)\n"
+            << "Allocated bytes : " << totalAllocs.bytes << " (" << totalAllocs.bytes / nodes << " per node)\n";
+    }
+    if (!tracePath.empty())
+    {
+        SearchTrace::setEnabled(false);
+        if (SearchTrace::writeChromeJson(tracePath))
+            out << "Trace written to " << tracePath << "\n";
+        else
+            std::cerr << "Failed to write trace: " << tracePath << "\n";
+    }
+    if (!treeLogPath.empty())
+    {
+        game.setTreeLog(nullptr);
+        uint64_t records = treeLog.records();
+        if (treeLog.close())
+            out << "Tree log written to " << treeLogPath << " (" << records << " nodes)\n";
+        else
+            std::cerr << "Failed to write tree log: " << treeLogPath << "\n";
+    }
+    if (SEARCH_STATS_ENABLED)
+        out << "First-move cut  : " << totalStats.firstMoveCutoffRate() << "\n"
+            << "TT hit rate     : " << totalStats.ttHitRate() << "\n";
+    else
+        out << "(search counters are disabled in this build: CHESS_SEARCH_STATS=OFF)\n";
+    out << "---------------------------\n"
+        << "Time to depth\n"
+        << std::setw(5) << "depth" << std::setw(12) << "time (ms)" << std::setw(12) << "nodes" << "\n";
+    for (int d = 1; d <= depth; ++d)
+        out << std::setw(5) << d << std::setw(12) << depthMs[d] << std::setw(12) << depthNodes[d] << "\n";
+    out << "---------------------------\n"
+        << "Search latency\n"
+        << latency.report();
+    if (perf)
+        printPerfReport(out);
+    return 0;
+}
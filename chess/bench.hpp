@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// -------------------------------------------------------------
+// ベンチマーク (chess bench [depth] [threads] [hashMB] [--json] [--trace file] [--perf] [--treelog file])
+// 組み込みの局面集 (序盤/中盤/終盤) を決定的モードで探索し、合計ノード数 (シグネチャ)、
+// 経過時間、NPS を表示する。変更で探索結果が変わっていないか (シグネチャが同じか) と、
+// 速度を1コマンドで確認するためのもの。ノード数が再現するのはスレッド数1のときだけなので
+// (ヘルパーとの置換表の共有のタイミングで変わる)、2スレッド以上ではシグネチャとして扱わない
+// -------------------------------------------------------------
+constexpr int BENCH_DEFAULT_DEPTH = 6;
+
+// ベンチマークの局面集 (FEN)。chess_bench のマイクロベンチマークも同じ局面を使う
+const std::vector<std::string> &benchPositions();
+
+// json = true なら、局面ごとの結果を探索統計つきの JSON (1局面1行) で表示し、最後の行に全体の集計
+// ({"summary":...}) を出す。標準出力は JSON の行だけになり、人が読む表は標準エラーに出る
+// tracePath が空でなければ、探索のトレースを Chrome の trace_event 形式で書き出す
+// perf = true なら、メインスレッドのハードウェアカウンタをフェーズごとに表示する
+// treeLogPath が空でなければ、メインスレッドの探索木を chess_treelog で読める形式で書き出す
+// 戻り値は main の終了コード
+int runBench(int depth, int threads, size_t hashMB, bool json = false, const std::string &tracePath = "",
+             bool perf = false, const std::string &treeLogPath = "");
@@ -1,4 +1,13 @@
 #include "chess_game.hpp"
+#include "alloc_counter.hpp"
+#include "perf_counters.hpp"
+#include "ponderer.hpp"
+#include "search_trace.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <sstream>
 
 /**
  * version 3.0
@@ -81,15 +90,225 @@ const int KingTable[8][8] = {
 const int MATE_SCORE = 99999999;
 const int DRAW_SCORE = 0; // 引き分けスコア
 
+// この値を超える評価値はメイトスコアとして扱う (置換表で手数補正が必要)
+const int MATE_BOUND = MATE_SCORE - 1000;
+
+// 停止要求と時間制限を確認する間隔 (ノード数, 2の冪)
+// 1ノード数十マイクロ秒なので、停止要求から数ミリ秒以内に探索が止まる
+const uint64_t STOP_CHECK_INTERVAL = 256;
+
+// スライド駒の方向 (前半4つがルーク/クイーン、後半4つがビショップ/クイーン)
+const int SLIDING_DIRECTIONS[8][2] = {
+    {1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+// -------------------------------------------------------------
+// Zobristハッシュ用の乱数表
+// -------------------------------------------------------------
+namespace
+{
+    struct ZobristKeys
+    {
+        uint64_t pieces[12][8][8]; // [駒種][行][列]
+        uint64_t castling[16];     // キャスリング可能性 (4bit) ごと
+        uint64_t enPassant[8];     // アンパッサン可能な列ごと
+        uint64_t sideToMove;       // 白番のときにXORする
+
+        ZobristKeys()
+        {
+            // 再現性のため固定シードの splitmix64 で生成する
+            uint64_t seed = 0x9E3779B97F4A7C15ULL;
+            auto next = [&seed]()
+            {
+                uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                return z ^ (z >> 31);
+            };
+            for (auto &piece : pieces)
+                for (auto &row : piece)
+                    for (auto &key : row)
+                        key = next();
+            for (auto &key : castling)
+                key = next();
+            for (auto &key : enPassant)
+                key = next();
+            sideToMove = next();
+        }
+    };
+
+    const ZobristKeys ZOBRIST;
+
+    // 駒 -> Zobrist表の添字 (白: 0-5, 黒: 6-11, 空マス: -1)
+    int pieceIndex(const Piece &p)
+    {
+        int base;
+        switch (std::toupper(p.type))
+        {
+        case 'P':
+            base = 0;
+            break;
+        case 'N':
+            base = 1;
+            break;
+        case 'B':
+            base = 2;
+            break;
+        case 'R':
+            base = 3;
+            break;
+        case 'Q':
+            base = 4;
+            break;
+        case 'K':
+            base = 5;
+            break;
+        default:
+            return -1;
+        }
+        return p.isWhite ? base : base + 6;
+    }
+
+    uint64_t pieceKey(const Piece &p, int r, int c)
+    {
+        int idx = pieceIndex(p);
+        return idx < 0 ? 0 : ZOBRIST.pieces[idx][r][c];
+    }
+
+    // FENのキャスリング欄と同じ意味の 4bit 値
+    int castlingIndex(const CastlingRights &cr)
+    {
+        int idx = 0;
+        if (!cr.whiteKingMoved && !cr.whiteRookKSidesMoved)
+            idx |= 1;
+        if (!cr.whiteKingMoved && !cr.whiteRookQSidesMoved)
+            idx |= 2;
+        if (!cr.blackKingMoved && !cr.blackRookKSidesMoved)
+            idx |= 4;
+        if (!cr.blackKingMoved && !cr.blackRookQSidesMoved)
+            idx |= 8;
+        return idx;
+    }
+
+    uint64_t stateKey(const CastlingRights &cr, const std::pair<int, int> &ep)
+    {
+        uint64_t key = ZOBRIST.castling[castlingIndex(cr)];
+        if (ep.first != -1)
+            key ^= ZOBRIST.enPassant[ep.second];
+        return key;
+    }
+
+    // 置換表にはメイトまでの手数をノード基準で保存する
+    int scoreToTT(int score, int ply)
+    {
+        if (score > MATE_BOUND)
+            return score + ply;
+        if (score < -MATE_BOUND)
+            return score - ply;
+        return score;
+    }
+
+    int scoreFromTT(int score, int ply)
+    {
+        if (score > MATE_BOUND)
+            return score - ply;
+        if (score < -MATE_BOUND)
+            return score + ply;
+        return score;
+    }
+
+    // 手順付け用の駒の価値 (MVV-LVA)
+    int orderingValue(char type)
+    {
+        switch (std::toupper(type))
+        {
+        case 'P':
+            return 100;
+        case 'N':
+            return 320;
+        case 'B':
+            return 330;
+        case 'R':
+            return 500;
+        case 'Q':
+            return 900;
+        case 'K':
+            return 20000;
+        default:
+            return 0;
+        }
+    }
+
+    // 手順付けのスコア帯 (上から置換表の手, 取る手/昇格, キラー手, history)
+    const int ORDER_TT_MOVE = 1 << 30;
+    const int ORDER_PV_MOVE = ORDER_TT_MOVE + 1;
+    const int ORDER_CAPTURE = 1 << 28;
+    const int ORDER_KILLER_1 = 1 << 27;
+    const int ORDER_KILLER_2 = ORDER_KILLER_1 - 1;
+    const int HISTORY_MAX = 1 << 20; // これを超えたら history 全体を半減する
+
+    // 静止探索のデルタ枝刈り: 取れる駒の価値 + この余裕を足しても alpha に届かない手は読まない
+    const int DELTA_MARGIN = 200;
+
+    // 選択的探索のパラメータ
+    const int NULL_MOVE_MIN_DEPTH = 3;
+    const int RFP_MAX_DEPTH = 3;
+    const int RFP_MARGIN = 120;       // 深さ1あたり
+    const int FUTILITY_MAX_DEPTH = 2;
+    const int FUTILITY_MARGIN = 150;  // 深さ1あたり
+    const int LMR_MIN_DEPTH = 3;
+    const size_t LMR_MIN_MOVE_INDEX = 3;
+
+    // アスピレーションウィンドウ: 半幅がこれを超えたら全幅に切り替える
+    const int ASPIRATION_MAX_DELTA = 1000;
+    const int NO_SCORE = MATE_SCORE + 1; // 前の反復の評価値が無いことを表す
+
+    // LMR の削減量: 深さと手順の位置の対数に比例させる
+    int lmrReduction(int depth, int moveIndex)
+    {
+        static const auto table = []
+        {
+            std::array<std::array<int, 64>, 64> t{};
+            for (int d = 1; d < 64; ++d)
+                for (int m = 1; m < 64; ++m)
+                    t[d][m] = static_cast<int>(0.75 + std::log(d) * std::log(m) / 2.25);
+            return t;
+        }();
+        return table[std::min(depth, 63)][std::min(moveIndex, 63)];
+    }
+
+    int squareIndex(const std::pair<int, int> &sq)
+    {
+        return sq.first * 8 + sq.second;
+    }
+
+    // scores[i..] の中で最大の手を i 番目に持ってくる (必要な分だけ並べる選択ソート)
+    void pickNextMove(std::vector<Move> &moves, std::vector<int> &scores, size_t i)
+    {
+        size_t best = i;
+        for (size_t j = i + 1; j < moves.size(); ++j)
+        {
+            if (scores[j] > scores[best])
+                best = j;
+        }
+        if (best != i)
+        {
+            std::swap(moves[i], moves[best]);
+            std::swap(scores[i], scores[best]);
+        }
+    }
+}
+
 // -------------------------------------------------------------
 // ChessGameクラス
 // -------------------------------------------------------------
 
 // コンストラクタ
 ChessGame::ChessGame()
+    : tt_(std::make_shared<TranspositionTable>()),
+      moveLatency_(std::make_shared<MoveLatencyStats>()),
+      rng_(static_cast<uint64_t>(std::time(nullptr)))
 {
     initBoard();
-    std::srand(std::time(0));
 }
 
 // -------------------------------------------------------------
@@ -173,6 +392,32 @@ void ChessGame::undoMove(Move m)
     }
 }
 
+// ----------------------------------------------------------------------
+// 探索のルートの移動 (makeMove/undoMove と同じく FEN 履歴も更新する)
+// 履歴の文字列は取り除くときに spareFens_ に戻し、次に積むときに領域ごと使い回す
+// ----------------------------------------------------------------------
+void ChessGame::makeRootMove(Move &m, bool nextTurnWhite)
+{
+    makeMoveInternal(m);
+    if (spareFens_.empty())
+    {
+        position_history_.emplace_back();
+    }
+    else
+    {
+        position_history_.push_back(std::move(spareFens_.back()));
+        spareFens_.pop_back();
+    }
+    writeBoardStateFEN(nextTurnWhite, position_history_.back());
+}
+
+void ChessGame::undoRootMove(const Move &m)
+{
+    unmakeMoveInternal(m);
+    spareFens_.push_back(std::move(position_history_.back()));
+    position_history_.pop_back();
+}
+
 // ----------------------------------------------------------------------
 // AI探索専用の移動 (MoveにUndo情報を記録し、状態を更新する)
 // ----------------------------------------------------------------------
@@ -190,6 +435,12 @@ void ChessGame::makeMoveInternal(Move &m)
     m.oldEnPassantSquare = enPassantSquare_;
     m.oldHalfMoveClock = halfMoveClock_;
     m.oldFullMoveNumber = fullMoveNumber_;
+    m.oldHashKey = hashKey_;
+
+    // 移動前のキャスリング権/アンパッサンのキーを外す (移動後に付け直す)
+    hashKey_ ^= stateKey(castlingRights, enPassantSquare_);
+    hashKey_ ^= pieceKey(pieceToMove, r1, c1);
+    hashKey_ ^= pieceKey(board[r2][c2], r2, c2);
 
     // キャプチャされた駒を記録 (通常/アンパッサンで取得元が異なる)
     // まず、通常キャプチャの可能性から始める (r2, c2)
@@ -216,6 +467,7 @@ void ChessGame::makeMoveInternal(Move &m)
 
         // m.capturedPiece をアンパッサンで捕獲されるポーンに上書き
         m.capturedPiece = board[capturedR][c2];
+        hashKey_ ^= pieceKey(m.capturedPiece, capturedR, c2);
 
         // 敵のポーンを盤面から削除
         board[capturedR][c2] = Piece('*', true);
@@ -234,6 +486,7 @@ void ChessGame::makeMoveInternal(Move &m)
         {
             int rookC1 = 7; // h列
             int rookC2 = 5; // f列
+            hashKey_ ^= pieceKey(board[r1][rookC1], r1, rookC1) ^ pieceKey(board[r1][rookC1], r2, rookC2);
             board[r2][rookC2] = board[r1][rookC1];
             board[r1][rookC1] = Piece('*', true);
         }
@@ -242,6 +495,7 @@ void ChessGame::makeMoveInternal(Move &m)
         {
             int rookC1 = 0; // a列
             int rookC2 = 3; // d列
+            hashKey_ ^= pieceKey(board[r1][rookC1], r1, rookC1) ^ pieceKey(board[r1][rookC1], r2, rookC2);
             board[r2][rookC2] = board[r1][rookC1];
             board[r1][rookC1] = Piece('*', true);
         }
@@ -264,6 +518,7 @@ void ChessGame::makeMoveInternal(Move &m)
         board[r2][c2].type = isWhite ? std::toupper(m.promotedTo) : std::tolower(m.promotedTo);
         // halfMoveClock はポーン移動で既にリセット済み
     }
+    hashKey_ ^= pieceKey(board[r2][c2], r2, c2);
 
     // =======================================================
     // 6. ゲーム状態の更新 (キャスリング権, アンパッサン, フルムーブ)
@@ -292,6 +547,9 @@ void ChessGame::makeMoveInternal(Move &m)
     {
         fullMoveNumber_++;
     }
+
+    // D. 新しいキャスリング権/アンパッサンのキーを付ける
+    hashKey_ ^= stateKey(castlingRights, enPassantSquare_);
 }
 // ----------------------------------------------------------------------
 // AI探索専用の移動解除 (Moveに記録されたUndo情報を使って状態を復元する)
@@ -382,6 +640,9 @@ void ChessGame::unmakeMoveInternal(Move m)
 
     // D. 50手ルールカウンターの復元
     halfMoveClock_ = m.oldHalfMoveClock;
+
+    // E. Zobristキーの復元
+    hashKey_ = m.oldHashKey;
 }
 
 // -------------------------------------------------------------
@@ -463,17 +724,9 @@ bool ChessGame::isSquareAttacked(int r, int c, bool attackingWhite) const
     }
 
     // 4. 直線移動駒 (R, B, Q) による攻撃チェック
-    std::vector<std::pair<int, int>> sliding_dirs = {
-        {1, 0}, {-1, 0}, {0, 1}, {0, -1}, // R, Q
-        {1, 1},
-        {1, -1},
-        {-1, 1},
-        {-1, -1} // B, Q
-    };
-
-    for (const auto &dir : sliding_dirs)
+    for (const auto &dir : SLIDING_DIRECTIONS)
     {
-        int dr = dir.first, dc = dir.second;
+        int dr = dir[0], dc = dir[1];
         int nr = r + dr, nc = c + dc;
         char required_type = ((dr == 0 || dc == 0) && dr != dc) ? 'R' : 'B';
 
@@ -505,7 +758,15 @@ bool ChessGame::isSquareAttacked(int r, int c, bool attackingWhite) const
 // ----------------------------------------------------------------------
 std::string ChessGame::getBoardStateFEN(bool turnWhite) const
 {
-    std::string fen = "";
+    std::string fen;
+    writeBoardStateFEN(turnWhite, fen);
+    return fen;
+}
+
+// fen の領域を再利用して書き込む (探索中の繰り返し判定で毎回確保しないように)
+void ChessGame::writeBoardStateFEN(bool turnWhite, std::string &fen) const
+{
+    fen.clear();
 
     // 1. 盤面 (Piece Placement)
     for (int r = 0; r < 8; ++r)
@@ -522,7 +783,7 @@ std::string ChessGame::getBoardStateFEN(bool turnWhite) const
             {
                 if (emptyCount > 0)
                 {
-                    fen += std::to_string(emptyCount);
+                    fen += static_cast<char>('0' + emptyCount);
                     emptyCount = 0;
                 }
                 fen += pieceType;
@@ -530,7 +791,7 @@ std::string ChessGame::getBoardStateFEN(bool turnWhite) const
         }
         if (emptyCount > 0)
         {
-            fen += std::to_string(emptyCount);
+            fen += static_cast<char>('0' + emptyCount);
         }
         if (r < 7)
         {
@@ -539,31 +800,34 @@ std::string ChessGame::getBoardStateFEN(bool turnWhite) const
     }
 
     // 2. 手番 (Active Color)
-    fen += turnWhite ? " w" : " b";
+    fen += turnWhite ? " w " : " b ";
 
     // 3. キャスリング権 (Castling Availability)
-    std::string castling = "";
+    size_t castlingStart = fen.size();
     if (!castlingRights.whiteKingMoved)
     {
         if (!castlingRights.whiteRookKSidesMoved)
-            castling += 'K'; // 白キングサイド
+            fen += 'K'; // 白キングサイド
         if (!castlingRights.whiteRookQSidesMoved)
-            castling += 'Q'; // 白クイーンサイド
+            fen += 'Q'; // 白クイーンサイド
     }
     if (!castlingRights.blackKingMoved)
     {
         if (!castlingRights.blackRookKSidesMoved)
-            castling += 'k'; // 黒キングサイド
+            fen += 'k'; // 黒キングサイド
         if (!castlingRights.blackRookQSidesMoved)
-            castling += 'q'; // 黒クイーンサイド
+            fen += 'q'; // 黒クイーンサイド
     }
-    fen += " " + (castling.empty() ? "-" : castling);
+    if (fen.size() == castlingStart)
+        fen += '-';
 
     // 4. アンパッサンターゲットマス (En Passant Target Square)
     if (enPassantSquare_.first != -1)
     {
         // 座標を代数表記に変換 (例: {2, 0} -> "a6")
-        fen += " " + coordsToAlgebraic(enPassantSquare_.first, enPassantSquare_.second);
+        fen += ' ';
+        fen += static_cast<char>('a' + enPassantSquare_.second);
+        fen += static_cast<char>('8' - enPassantSquare_.first);
     }
     else
     {
@@ -572,23 +836,27 @@ std::string ChessGame::getBoardStateFEN(bool turnWhite) const
 
     // Note: 50手ルールとフルムーブ数は三回繰り返し判定に不要なため、ここでは含めない
     // ただし、完全なFENが必要な場合は " " + std::to_string(halfMoveClock_) + " " + std::to_string(fullMoveNumber_) を追加
-
-    return fen;
 }
 // ----------------------------------------------------------------------
 // 三回繰り返しによる引き分け判定
 // ----------------------------------------------------------------------
 bool ChessGame::isDrawByThreefoldRepetition(bool turnWhite) const
 {
+    // 履歴が3局面未満なら、FENを作るまでもなく3回一致することはない
+    if (position_history_.size() < 3)
+    {
+        return false;
+    }
+
     // 現在のFENを取得
-    std::string currentFEN = getBoardStateFEN(turnWhite);
+    writeBoardStateFEN(turnWhite, fenBuffer_);
     int count = 0;
 
     // 履歴を逆順に辿って、現在のFENと一致する回数を数える
     // Note: FEN履歴には「手を指した後」の盤面が入っている
     for (const auto &historyFEN : position_history_)
     {
-        if (historyFEN == currentFEN)
+        if (historyFEN == fenBuffer_)
         {
             count++;
         }
@@ -604,25 +872,13 @@ bool ChessGame::isDrawByThreefoldRepetition(bool turnWhite) const
 
 void ChessGame::generateSlidingMoves(int r, int c, bool white, char type, std::vector<Move> &moves) const
 {
-    std::vector<std::pair<int, int>> directions;
-    if (type == 'R' || type == 'Q')
-    {
-        directions.push_back({1, 0});
-        directions.push_back({-1, 0});
-        directions.push_back({0, 1});
-        directions.push_back({0, -1});
-    }
-    if (type == 'B' || type == 'Q')
-    {
-        directions.push_back({1, 1});
-        directions.push_back({1, -1});
-        directions.push_back({-1, 1});
-        directions.push_back({-1, -1});
-    }
+    // SLIDING_DIRECTIONS の前半4方向がルーク、後半4方向がビショップ (クイーンは全て)
+    int first = type == 'B' ? 4 : 0;
+    int last = type == 'R' ? 4 : 8;
 
-    for (const auto &dir : directions)
+    for (int d = first; d < last; ++d)
     {
-        int dr = dir.first, dc = dir.second;
+        int dr = SLIDING_DIRECTIONS[d][0], dc = SLIDING_DIRECTIONS[d][1];
         int nr = r + dr, nc = c + dc;
 
         while (nr >= 0 && nr < 8 && nc >= 0 && nc < 8)
@@ -651,8 +907,23 @@ void ChessGame::generateSlidingMoves(int r, int c, bool white, char type, std::v
 // 合法手生成 (Move struct に特殊フラグを設定)
 // ----------------------------------------------------------------------
 std::vector<Move> ChessGame::generateMoves(bool white) const
+{
+    return generateMoves(white, false);
+}
+
+// tacticalOnly = true の場合は、取る手と昇格だけを返す (静止探索用)
+std::vector<Move> ChessGame::generateMoves(bool white, bool tacticalOnly) const
 {
     std::vector<Move> moves;
+    generateMoves(white, tacticalOnly, moves);
+    return moves;
+}
+
+// moves の領域を再利用して書き込む (探索では ply ごとのバッファを渡し、確保を避ける)
+void ChessGame::generateMoves(bool white, bool tacticalOnly, std::vector<Move> &moves) const
+{
+    PerfScope perf(PERF_MOVEGEN);
+    moves.clear();
 
     // 暫定的な合法手生成 (ここでは、まだ王手回避のチェックはしない)
     for (int r = 0; r < 8; ++r)
@@ -829,20 +1100,32 @@ std::vector<Move> ChessGame::generateMoves(bool white) const
                 }
             }
         }
-    } // -------------------------------------------------
+    }
+
+    // 静止探索では、合法性チェックの前に静かな手を除いておく
+    if (tacticalOnly)
+    {
+        moves.erase(std::remove_if(moves.begin(), moves.end(),
+                                   [this](const Move &m)
+                                   { return !isTactical(m); }),
+                    moves.end());
+    }
+
+    // -------------------------------------------------
     // 王手回避チェック (高速化のため、make/unmake ペアを使用)
     // -------------------------------------------------
-    std::vector<Move> validMoves;
+    // 合法な手を先頭に詰めていく (順序は変えない)
+    size_t legalCount = 0;
 
     // constメソッド内で状態を変更できないため、thisポインタの定数性を一時的にキャストして解除し、
     // 内部関数（make/unmake）を呼び出せるようにします。
     // ※これはC++の制約を回避する一般的な手法ですが、注意が必要です。
     ChessGame *nonConstThis = const_cast<ChessGame *>(this);
 
-    for (const auto &move : moves)
+    for (size_t i = 0; i < moves.size(); ++i)
     {
         // 1. Moveをコピー (Undo情報記録用)
-        Move tempMove = move;
+        Move tempMove = moves[i];
 
         // 2. 状態を進める (Undo情報が tempMove に記録される)
         // const_cast経由で非constの内部関数を呼び出す
@@ -855,14 +1138,14 @@ std::vector<Move> ChessGame::generateMoves(bool white) const
         // isSquareAttackedの第3引数: 攻撃側（敵）の色
         if (!nonConstThis->isSquareAttacked(kingPos.first, kingPos.second, !white))
         {
-            validMoves.push_back(move);
+            moves[legalCount++] = moves[i];
         }
 
         // 5. 状態を元に戻す (次の擬似合法手のチェックのため)
         nonConstThis->unmakeMoveInternal(tempMove);
     }
 
-    return validMoves;
+    moves.resize(legalCount);
 }
 
 // -------------------------------------------------------------
@@ -870,6 +1153,7 @@ std::vector<Move> ChessGame::generateMoves(bool white) const
 // -------------------------------------------------------------
 int ChessGame::evaluate() const
 {
+    PerfScope perf(PERF_EVAL);
 
     // 終盤判定
     bool is_endgame = true;
@@ -1074,19 +1358,30 @@ int ChessGame::evaluate() const
 }
 
 // ----------------------------------------------------------------------
-// Minimaxアルゴリズム (Alpha-Beta枝刈り付き)
+// Negamaxアルゴリズム (Alpha-Beta枝刈り + Principal Variation Search)
+// 評価値は常に「手番側から見た値」。相手の値は符号を反転して使う
 // ----------------------------------------------------------------------
-int ChessGame::minimax(int depth, bool isMaximizingPlayer, int alpha, int beta)
+int ChessGame::negamax(int depth, int ply, bool white, int alpha, int beta, bool allowNull)
 {
-    // =======================================================
-    // 1. 基本ケース (Base Cases)
-    // =======================================================
-    if (depth == 0)
+    NodeAllocScope allocScope;
+    if (depth <= 0)
+    {
+        // 探索深さに達したら、駒の取り合いが収まるまで静止探索を行う
+        return quiescence(ply, white, alpha, beta);
+    }
+
+    countNode();
+    clearPv(ply);
+
+    // 停止要求 (中断された反復の結果は捨てられるので値は何でもよい)
+    if (isAborted())
     {
-        // 探索深さに達したら評価値を返す
-        return evaluate();
+        return 0;
     }
 
+    // =======================================================
+    // 1. 基本ケース (Base Cases)
+    // =======================================================
     // 50手ルールによる引き分け判定
     // halfMoveClock_ は makeMoveInternal で更新されている
     if (halfMoveClock_ >= 100)
@@ -1095,178 +1390,1454 @@ int ChessGame::minimax(int depth, bool isMaximizingPlayer, int alpha, int beta)
     }
 
     // 三回繰り返しによる引き分け判定
-    // isDrawByThreefoldRepetition は history_ をチェックするため、この関数が
-    // 正しく実装されている必要があります。
-    if (isDrawByThreefoldRepetition(isMaximizingPlayer))
+    if (isDrawByThreefoldRepetition(white))
     {
         return DRAW_SCORE;
     }
 
     // ---------------------------------------------
-    // 手の生成
+    // 置換表の参照
     // ---------------------------------------------
-    // isMaximizingPlayer = true の場合、現在のターンプレイヤー（白/黒）として生成
-    std::vector<Move> possibleMoves = generateMoves(isMaximizingPlayer);
-
-    // メイト/ステイルメイト判定
-    if (possibleMoves.empty())
+    int origAlpha = alpha;
+    uint64_t key = positionKey(white);
+    TranspositionTable::Data ttData;
+    uint16_t ttMove = 0;
+    countStat(&SearchStats::ttProbes);
+    if (tt_->probe(key, ttData))
     {
-        std::pair<int, int> kingPos = findKing(isMaximizingPlayer);
-        bool isCheck = isSquareAttacked(kingPos.first, kingPos.second, !isMaximizingPlayer);
-
-        if (isCheck)
-        {
-            // チェックメイト (現在のプレイヤーは負け)
-            // 評価値は、depthが深いほどメイトまでの手数が短いことを示すように補正する
-            return isMaximizingPlayer ? (-MATE_SCORE + (MAX_DEPTH - depth)) : (MATE_SCORE - (MAX_DEPTH - depth));
-        }
-        else
+        countStat(&SearchStats::ttHits);
+        ttMove = ttData.move;
+        if (ttData.depth >= depth)
         {
-            // ステイルメイト (引き分け)
-            return DRAW_SCORE;
+            int ttScore = scoreFromTT(ttData.score, ply);
+            if (ttData.bound == TranspositionTable::BOUND_EXACT ||
+                (ttData.bound == TranspositionTable::BOUND_LOWER && ttScore >= beta) ||
+                (ttData.bound == TranspositionTable::BOUND_UPPER && ttScore <= alpha))
+            {
+                if (treeLog_)
+                    treeNodeFlags_[ply] |= TREE_TT_CUTOFF;
+                return ttScore;
+            }
         }
     }
 
-    // =======================================================
-    // 2. 最大化プレイヤー (Maximizer: Whiteの番を想定)
-    // =======================================================
-    if (isMaximizingPlayer)
-    {
-        int maxEval = -MATE_SCORE; // 非常に低い値で初期化
+    // ---------------------------------------------
+    // 選択的探索 (手の生成より前に打ち切れるもの)
+    // ---------------------------------------------
+    std::pair<int, int> kingPos = findKing(white);
+    bool inCheck = kingPos.first != -1 && isSquareAttacked(kingPos.first, kingPos.second, !white);
+    bool pvNode = beta - alpha > 1;
+    int staticEval = inCheck ? -MATE_SCORE : (white ? evaluate() : -evaluate());
 
-        for (const auto &move : possibleMoves)
+    if (!pvNode && !inCheck && std::abs(beta) < MATE_BOUND)
+    {
+        // A. リバースフューティリティ (静的ヌルムーブ):
+        //    末端近くで静的評価が beta を余裕を持って上回るなら、そのまま fail-high とする
+        if (options_.reverseFutilityPruning && depth <= RFP_MAX_DEPTH &&
+            staticEval - RFP_MARGIN * depth >= beta)
         {
-            Move currentMove = move; // Moveをコピー (Undo情報記録用)
-
-            // 状態を進める (historyは更新しない makeMoveInternal を使用)
-            makeMoveInternal(currentMove);
+            countStat(&SearchStats::reverseFutilityPrunes);
+            if (treeLog_)
+                treeNodeFlags_[ply] |= TREE_NODE_PRUNED;
+            return staticEval;
+        }
 
-            // 再帰探索 (次は最小化プレイヤー)
-            int eval = minimax(depth - 1, false, alpha, beta);
+        // B. ヌルムーブ枝刈り: パスしても beta を超えるなら、実際の手ではもっと良いはず
+        //    ツークツワンクが起きやすいポーンだけの終盤と、連続したパスでは行わない
+        if (options_.nullMovePruning && allowNull && depth >= NULL_MOVE_MIN_DEPTH &&
+            staticEval >= beta && hasNonPawnMaterial(white))
+        {
+            // 適応的な削減量: 深いノードほど大きく削る
+            int R = depth > 6 ? 3 : 2;
+            countStat(&SearchStats::nullMoveTries);
 
-            // 状態を元に戻す
-            unmakeMoveInternal(currentMove);
+            std::pair<int, int> oldEnPassant = enPassantSquare_;
+            uint64_t oldKey = hashKey_;
+            hashKey_ ^= stateKey(castlingRights, enPassantSquare_);
+            enPassantSquare_ = {-1, -1};
+            hashKey_ ^= stateKey(castlingRights, enPassantSquare_);
 
-            // スコア更新
-            maxEval = std::max(maxEval, eval);
+            int nullEval = -searchChild(depth - 1 - R, ply + 1, !white, -beta, -beta + 1, nullptr, 0, TREE_NULL_MOVE,
+                                        false);
 
-            // ★ Alpha更新: 見つけた最善のスコアでαを更新 ★
-            alpha = std::max(alpha, maxEval);
+            enPassantSquare_ = oldEnPassant;
+            hashKey_ = oldKey;
 
-            // ★ Beta枝刈り: この枝の最小スコア (β) が、既に他の枝で見つけた最大スコア (α) 以下の場合、
-            // これ以上探索してもより良い結果は見つからないため、探索を打ち切る
-            if (beta <= alpha)
+            if (isAborted())
             {
-                break;
+                return 0;
+            }
+            if (nullEval >= beta)
+            {
+                countStat(&SearchStats::nullMoveCutoffs);
+                if (treeLog_)
+                    treeNodeFlags_[ply] |= TREE_NODE_PRUNED;
+                // 未検証のメイトスコアは返さない
+                return nullEval >= MATE_BOUND ? beta : nullEval;
             }
         }
-        return maxEval;
     }
+
+    // C. フューティリティ枝刈り: 末端近くで静的評価に余裕を足しても alpha に届かないなら
+    //    局面を大きく変えない静かな手 (王手でないもの) は読まない
+    bool futilityPrune = options_.futilityPruning && !pvNode && !inCheck && depth <= FUTILITY_MAX_DEPTH &&
+                         std::abs(alpha) < MATE_BOUND && staticEval + FUTILITY_MARGIN * depth <= alpha;
+
+    // ---------------------------------------------
+    // 手の生成
+    // ---------------------------------------------
+    std::vector<Move> &possibleMoves = moveLists_[ply];
+    generateMoves(white, false, possibleMoves);
+
+    // メイト/ステイルメイト判定
+    if (possibleMoves.empty())
+    {
+        // チェックメイトなら手番側の負け。近いメイトほど絶対値が大きくなるよう ply で補正する
+        return inCheck ? -MATE_SCORE + ply : DRAW_SCORE;
+    }
+
+    // 手順付け: 前の反復の読み筋 > 置換表の手 > 取る手 (MVV-LVA) > キラー手 > history
+    uint16_t pvMove = followPv_ && ply < prevPvLength_ ? prevPv_[ply] : 0;
+    std::vector<int> &moveScores = moveScoreLists_[ply];
+    scoreMoves(possibleMoves, moveScores, pvMove, ttMove, ply, white);
+
     // =======================================================
-    // 3. 最小化プレイヤー (Minimizer: Blackの番を想定)
+    // 2. Principal Variation Search
     // =======================================================
-    else
+    // 最初の手 (PVの候補) だけを全幅の窓で読み、残りはヌルウィンドウ (alpha, alpha+1) で
+    // 「alpha を超えないこと」だけを確かめる。超えた (fail-high) 場合に限り全幅で再探索する
+    int bestEval = -MATE_SCORE;
+    uint16_t bestMovePacked = 0;
+
+    for (size_t moveIndex = 0; moveIndex < possibleMoves.size(); ++moveIndex)
     {
-        int minEval = MATE_SCORE; // 非常に高い値で初期化
+        pickNextMove(possibleMoves, moveScores, moveIndex);
+        const Move &move = possibleMoves[moveIndex];
+        bool firstMove = moveIndex == 0;
+        bool quiet = !isTactical(move);
+        bool isKiller = moveScores[moveIndex] >= ORDER_KILLER_2 && moveScores[moveIndex] < ORDER_CAPTURE;
 
-        for (const auto &move : possibleMoves)
-        {
-            Move currentMove = move;
+        Move currentMove = move; // Moveをコピー (Undo情報記録用)
 
-            // 状態を進める
-            makeMoveInternal(currentMove);
+        // 状態を進める (historyは更新しない makeMoveInternal を使用)
+        makeMoveInternal(currentMove);
 
-            // 再帰探索 (次は最大化プレイヤー)
-            int eval = minimax(depth - 1, true, alpha, beta);
+        // 王手になる手は枝刈り/削減の対象外 (静かな2手目以降だけ確認すれば足りる)
+        bool givesCheck = false;
+        if (quiet && !firstMove)
+        {
+            std::pair<int, int> enemyKing = findKing(!white);
+            givesCheck = enemyKing.first != -1 && isSquareAttacked(enemyKing.first, enemyKing.second, white);
+        }
 
-            // 状態を元に戻す
+        if (futilityPrune && quiet && !firstMove && !givesCheck)
+        {
             unmakeMoveInternal(currentMove);
+            countStat(&SearchStats::futilityPrunes);
+            if (treeLog_)
+                logTreeNode(depth - 1, ply + 1, -beta, -alpha, 0, &move, moveIndex, TREE_PRUNED);
+            continue;
+        }
+
+        int eval;
+        if (firstMove)
+        {
+            eval = -searchChild(depth - 1, ply + 1, !white, -beta, -alpha, &move, moveIndex, 0);
+        }
+        else
+        {
+            // レイトムーブリダクション: 手順の後ろの静かな手は浅く読み、alpha を超えたら読み直す
+            int reduction = 0;
+            if (options_.lateMoveReductions && depth >= LMR_MIN_DEPTH && moveIndex >= LMR_MIN_MOVE_INDEX &&
+                quiet && !isKiller && !inCheck && !givesCheck)
+            {
+                reduction = std::min(lmrReduction(depth, static_cast<int>(moveIndex)), depth - 2);
+                countStat(&SearchStats::lmrReductions);
+            }
+
+            eval = -searchChild(depth - 1 - reduction, ply + 1, !white, -alpha - 1, -alpha, &move, moveIndex,
+                                reduction > 0 ? TREE_REDUCED : 0);
+            if (reduction > 0 && eval > alpha)
+            {
+                countStat(&SearchStats::lmrResearches);
+                eval = -searchChild(depth - 1, ply + 1, !white, -alpha - 1, -alpha, &move, moveIndex,
+                                    TREE_LMR_RESEARCH);
+            }
+            if (eval > alpha && eval < beta)
+            {
+                eval = -searchChild(depth - 1, ply + 1, !white, -beta, -alpha, &move, moveIndex, TREE_PVS_RESEARCH);
+            }
+        }
+
+        // 状態を元に戻す
+        unmakeMoveInternal(currentMove);
 
-            // スコア更新
-            minEval = std::min(minEval, eval);
+        // 読み筋をたどるのは各ノードの最初の手 (前の反復の読み筋の手) だけ
+        followPv_ = false;
 
-            // ★ Beta更新: 見つけた最善のスコアでβを更新 ★
-            beta = std::min(beta, minEval);
+        // 中断された探索の結果は置換表に保存しない
+        if (isAborted())
+        {
+            return 0;
+        }
+
+        // スコア更新
+        if (eval > bestEval || bestMovePacked == 0)
+        {
+            bestEval = eval;
+            bestMovePacked = TranspositionTable::packMove(move);
+        }
+        if (eval > alpha)
+        {
+            updatePv(ply, TranspositionTable::packMove(move));
+        }
 
-            // ★ Alpha枝刈り: この枝の最大スコア (α) が、既に他の枝で見つけた最小スコア (β) 以上の場合、
-            // これ以上探索してもより良い結果は見つからないため、探索を打ち切る
-            if (beta <= alpha)
+        // ★ Alpha更新と Beta枝刈り ★
+        // 相手は既に beta 以下に抑える手を持っているので、これ以上探索しても結果は変わらない
+        alpha = std::max(alpha, bestEval);
+        if (alpha >= beta)
+        {
+            countStat(&SearchStats::betaCutoffs);
+            if (treeLog_)
+                treeCutoffIndex_[ply] = static_cast<int8_t>(std::min<size_t>(moveIndex, INT8_MAX));
+            if (firstMove)
             {
-                break;
+                countStat(&SearchStats::firstMoveCutoffs);
+            }
+            // 静かな手によるカットはキラー手と history に記録する
+            if (quiet)
+            {
+                updateQuietHeuristics(move, depth, ply, white);
             }
+            break;
         }
-        return minEval;
     }
+
+    // =======================================================
+    // 3. 置換表への保存
+    // =======================================================
+    TranspositionTable::Bound bound = bestEval <= origAlpha ? TranspositionTable::BOUND_UPPER
+                                      : bestEval >= beta    ? TranspositionTable::BOUND_LOWER
+                                                            : TranspositionTable::BOUND_EXACT;
+    tt_->store(key, depth, scoreToTT(bestEval, ply), bound, bestMovePacked);
+
+    return bestEval;
+}
+
+// ----------------------------------------------------------------------
+// 子ノードの探索 (negamax) と探索木のログへの記録
+// alpha/beta と戻り値は子ノードの手番側から見た値。move はヌルムーブなら nullptr
+// ----------------------------------------------------------------------
+int ChessGame::searchChild(int depth, int ply, bool white, int alpha, int beta, const Move *move,
+                           size_t moveIndex, uint8_t flags, bool allowNull)
+{
+    if (!treeLog_ || ply >= MAX_PLY)
+    {
+        return negamax(depth, ply, white, alpha, beta, allowNull);
+    }
+
+    treeCutoffIndex_[ply] = -1;
+    treeNodeFlags_[ply] = 0;
+    int score = negamax(depth, ply, white, alpha, beta, allowNull);
+    // 中断された探索の値は意味を持たないので記録しない
+    if (!isAborted())
+    {
+        logTreeNode(depth, ply, alpha, beta, score, move, moveIndex, flags | treeNodeFlags_[ply]);
+    }
+    return score;
 }
 
-Move ChessGame::bestMove(bool white)
+void ChessGame::logTreeNode(int depth, int ply, int alpha, int beta, int score, const Move *move,
+                            size_t moveIndex, uint8_t flags)
 {
-    // MATE_SCORE が定義されていることを前提とする
-    int bestScore = white ? -MATE_SCORE : MATE_SCORE;
-    Move best_move;
+    TreeLogRecord record;
+    record.alpha = alpha;
+    record.beta = beta;
+    record.score = score;
+    record.move = move ? TranspositionTable::packMove(*move) : 0;
+    record.ply = static_cast<uint8_t>(ply);
+    record.depth = static_cast<int8_t>(std::max(depth, static_cast<int>(INT8_MIN)));
+    record.moveIndex = static_cast<uint8_t>(std::min<size_t>(moveIndex, UINT8_MAX));
+    record.cutoffIndex = (flags & TREE_PRUNED) || ply >= MAX_PLY ? -1 : treeCutoffIndex_[ply];
+    record.flags = flags;
+    record.rootDepth = static_cast<uint8_t>(rootDepth_);
+    treeLog_->write(record);
+}
 
-    auto moves = generateMoves(white);
-    if (moves.empty())
+// ----------------------------------------------------------------------
+// 静止探索 (Quiescence Search)
+// 探索の末端で、取る手と昇格だけを局面が落ち着くまで読む (水平線効果の対策)
+// ----------------------------------------------------------------------
+int ChessGame::quiescence(int ply, bool white, int alpha, int beta)
+{
+    NodeAllocScope allocScope;
+    countNode();
+    clearPv(ply); // 静止探索の手は読み筋に含めない
+    countStat(&SearchStats::quiescenceNodes);
+    if (isAborted())
     {
-        return Move();
+        return 0;
     }
 
-    std::vector<Move> tiedMoves;
+    // 手のバッファの上限を超える深さでは、取り合いを読まずに静的評価を返す
+    if (ply >= MAX_PLY)
+    {
+        return white ? evaluate() : -evaluate();
+    }
+
+    std::pair<int, int> kingPos = findKing(white);
+    bool inCheck = kingPos.first != -1 && isSquareAttacked(kingPos.first, kingPos.second, !white);
 
-    for (const auto &move : moves)
+    // 王手されている場合は「何もしない」選択肢が無いので、全ての応手を読む
+    int bestEval = -MATE_SCORE + ply;
+    std::vector<Move> &moves = moveLists_[ply];
+    if (inCheck)
     {
-        Move currentMove = move; // Moveをコピーし、Undo情報を記録する準備
+        generateMoves(white, false, moves);
+        if (moves.empty())
+        {
+            return -MATE_SCORE + ply;
+        }
+    }
+    else
+    {
+        // スタンドパット: 取り合いを続けずに現局面の評価で打ち切れる
+        int standPat = white ? evaluate() : -evaluate();
+        if (standPat >= beta)
+        {
+            return standPat;
+        }
 
-        // 1. 移動を実行 (参照渡しで currentMove に Undo情報が記録される)
-        // NOTE: AI探索のルートノードでは、historyを更新する public な makeMove を使用
-        makeMove(currentMove);
+        // デルタ枝刈り (全体): クイーンを取って昇格しても alpha に届かない
+        if (standPat + orderingValue('Q') * 2 + DELTA_MARGIN < alpha)
+        {
+            return standPat;
+        }
 
-        // 2. minimax で評価
-        // 探索深さ MAX_DEPTH-1、相手の手番として呼び出す
-        int score = minimax(MAX_DEPTH - 1, !white, -MATE_SCORE, MATE_SCORE);
+        alpha = std::max(alpha, standPat);
+        bestEval = standPat;
+        generateMoves(white, true, moves);
+    }
 
-        // 3. 移動を元に戻す (Undo情報が記録された currentMove を使用)
-        undoMove(currentMove); // public な undoMove を使用
+    std::vector<int> &moveScores = moveScoreLists_[ply];
+    scoreMoves(moves, moveScores, 0, 0, ply, white);
 
-        if (white)
+    for (size_t moveIndex = 0; moveIndex < moves.size(); ++moveIndex)
+    {
+        pickNextMove(moves, moveScores, moveIndex);
+        const Move &move = moves[moveIndex];
+
+        if (!inCheck)
         {
-            if (score > bestScore)
+            // デルタ枝刈り (手ごと): 取る駒の価値を足しても alpha に届かない
+            int gain = move.isEnPassant ? orderingValue('P') : orderingValue(board[move.to.first][move.to.second].type);
+            if (move.promotedTo != '*')
             {
-                bestScore = score;
-                tiedMoves.clear();
-                tiedMoves.push_back(move);
+                gain += orderingValue(move.promotedTo) - orderingValue('P');
             }
-            else if (score == bestScore)
+            if (bestEval + gain + DELTA_MARGIN <= alpha)
             {
-                tiedMoves.push_back(move);
+                continue;
             }
-        }
-        else
-        {
-            if (score < bestScore)
+
+            // SEE が負になる (駒損になる) 取り合いは読まない
+            if (move.promotedTo == '*' && isLosingCapture(move))
             {
-                bestScore = score;
-                tiedMoves.clear();
-                tiedMoves.push_back(move);
+                continue;
             }
-            else if (score == bestScore)
+        }
+
+        Move currentMove = move;
+        makeMoveInternal(currentMove);
+        int eval = -quiescence(ply + 1, !white, -beta, -alpha);
+        unmakeMoveInternal(currentMove);
+
+        if (isAborted())
+        {
+            return 0;
+        }
+
+        if (eval > bestEval)
+        {
+            bestEval = eval;
+            if (eval > alpha)
             {
-                tiedMoves.push_back(move);
+                alpha = eval;
+                if (alpha >= beta)
+                {
+                    break;
+                }
             }
         }
     }
+    return bestEval;
+}
 
-    if (!tiedMoves.empty())
+// ----------------------------------------------------------------------
+// 取り合いで駒損になる手か
+// 取る駒以下の価値の駒で取る手は SEE を計算するまでもなく損にならない
+// ----------------------------------------------------------------------
+bool ChessGame::isLosingCapture(const Move &move) const
+{
+    int victimValue = move.isEnPassant ? orderingValue('P') : orderingValue(board[move.to.first][move.to.second].type);
+    int attackerValue = orderingValue(board[move.from.first][move.from.second].type);
+    if (attackerValue <= victimValue)
     {
-        return tiedMoves[std::rand() % tiedMoves.size()];
+        return false;
     }
-    return best_move;
+    return see(move) < 0;
 }
 
-// -------------------------------------------------------------
-// メインルーチン (初期化と入力/ゲーム実行)
-// -------------------------------------------------------------
-
+// ----------------------------------------------------------------------
+// 静的交換評価 (Static Exchange Evaluation)
+// 1つのマスで、両者が最も価値の低い駒から順に取り返し合った場合の駒得を返す
+// (手番側から見た値。実際に手を指さず、占有マスの集合だけを更新して計算する)
+// ----------------------------------------------------------------------
+int ChessGame::see(const Move &move) const
+{
+    int tr = move.to.first, tc = move.to.second;
+    const Piece &mover = board[move.from.first][move.from.second];
+    if (mover.type == '*')
+    {
+        return 0;
+    }
+
+    // 駒が残っているマスの集合 (ビット r*8+c)。取られた/動いた駒はここから外す
+    uint64_t occupied = 0;
+    for (int r = 0; r < 8; r++)
+        for (int c = 0; c < 8; c++)
+            if (board[r][c].type != '*')
+                occupied |= 1ULL << (r * 8 + c);
+
+    // 交換の各段階での駒得 (gain[d] は d 手目を指した側から見た値)
+    int gain[32];
+    int d = 0;
+    gain[0] = move.isEnPassant ? orderingValue('P') : orderingValue(board[tr][tc].type);
+    int onSquare = orderingValue(mover.type); // 取り返される駒の価値
+    if (move.promotedTo != '*')
+    {
+        gain[0] += orderingValue(move.promotedTo) - orderingValue('P');
+        onSquare = orderingValue(move.promotedTo);
+    }
+    occupied &= ~(1ULL << (move.from.first * 8 + move.from.second));
+    if (move.isEnPassant)
+    {
+        int capturedR = mover.isWhite ? tr + 1 : tr - 1;
+        occupied &= ~(1ULL << (capturedR * 8 + tc));
+    }
+
+    bool side = !mover.isWhite;
+    int ar, ac;
+    while (d < 31 && leastValuableAttacker(tr, tc, side, occupied, ar, ac))
+    {
+        // キングで取り返せるのは、相手にもう攻撃駒が残っていない場合だけ
+        if (std::toupper(board[ar][ac].type) == 'K')
+        {
+            int r2, c2;
+            uint64_t without = occupied & ~(1ULL << (ar * 8 + ac));
+            if (leastValuableAttacker(tr, tc, !side, without, r2, c2))
+            {
+                break;
+            }
+        }
+
+        d++;
+        gain[d] = onSquare - gain[d - 1];
+        onSquare = orderingValue(board[ar][ac].type);
+        occupied &= ~(1ULL << (ar * 8 + ac)); // 後ろに隠れていた駒 (X線) が次の探索で見える
+        side = !side;
+    }
+
+    // 各段階で「取り返さない」選択肢も考慮して、末尾から畳み込む
+    while (d > 0)
+    {
+        gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+        d--;
+    }
+    return gain[0];
+}
+
+// ----------------------------------------------------------------------
+// SEE 用: occupied に残っている駒のうち、(r, c) を攻撃する side の最も価値の低い駒
+// スライド駒は occupied を使って遮蔽を判定するので、取り除かれた駒の後ろも見える
+// ----------------------------------------------------------------------
+bool ChessGame::leastValuableAttacker(int r, int c, bool side, uint64_t occupied, int &outR, int &outC) const
+{
+    int bestValue = 1 << 30;
+    auto consider = [&](int nr, int nc, char wanted1, char wanted2)
+    {
+        if (nr < 0 || nr > 7 || nc < 0 || nc > 7 || !(occupied & (1ULL << (nr * 8 + nc))))
+            return;
+        const Piece &p = board[nr][nc];
+        char upper = std::toupper(p.type);
+        if (p.isWhite != side || (upper != wanted1 && upper != wanted2))
+            return;
+        int value = orderingValue(upper);
+        if (value < bestValue)
+        {
+            bestValue = value;
+            outR = nr;
+            outC = nc;
+        }
+    };
+
+    // ポーン (白は下側から、黒は上側から取る)
+    int pr = side ? r + 1 : r - 1;
+    consider(pr, c - 1, 'P', 'P');
+    consider(pr, c + 1, 'P', 'P');
+
+    static const int knightMoves[8][2] = {{2, 1}, {2, -1}, {-2, 1}, {-2, -1}, {1, 2}, {1, -2}, {-1, 2}, {-1, -2}};
+    for (const auto &km : knightMoves)
+        consider(r + km[0], c + km[1], 'N', 'N');
+
+    static const int dirs[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+    for (int i = 0; i < 8; ++i)
+    {
+        char slider = i < 4 ? 'R' : 'B';
+        int nr = r + dirs[i][0], nc = c + dirs[i][1];
+        while (nr >= 0 && nr < 8 && nc >= 0 && nc < 8)
+        {
+            if (occupied & (1ULL << (nr * 8 + nc)))
+            {
+                consider(nr, nc, slider, 'Q');
+                break;
+            }
+            nr += dirs[i][0];
+            nc += dirs[i][1];
+        }
+    }
+
+    for (int dr = -1; dr <= 1; dr++)
+        for (int dc = -1; dc <= 1; dc++)
+            if (dr != 0 || dc != 0)
+                consider(r + dr, c + dc, 'K', 'K');
+
+    return bestValue != (1 << 30);
+}
+
+// ----------------------------------------------------------------------
+// 相手に取られると駒損になる (SEE > 0 で取られる) white 側の駒のマス
+// GUI でのハンギングピース表示などに使う。探索は行わない
+// ----------------------------------------------------------------------
+std::vector<std::pair<int, int>> ChessGame::hangingPieces(bool white) const
+{
+    std::vector<std::pair<int, int>> squares;
+    for (const auto &capture : generateMoves(!white, true))
+    {
+        const Piece &target = board[capture.to.first][capture.to.second];
+        if (target.type == '*' || target.isWhite != white)
+            continue;
+        if (std::find(squares.begin(), squares.end(), capture.to) != squares.end())
+            continue;
+        if (see(capture) > 0)
+            squares.push_back(capture.to);
+    }
+    return squares;
+}
+
+// 局面の段階 (応答時間の内訳用)
+// 駒の量 (ナイト/ビショップ 1, ルーク 2, クイーン 4, 初期配置で 24) で終盤を、
+// 初期位置に残っているナイト/ビショップの数で序盤を判定する (手数は盤面から復元できないため)
+GamePhase ChessGame::gamePhase() const
+{
+    int material = 0;
+    int undevelopedMinors = 0;
+    for (int r = 0; r < 8; r++)
+    {
+        for (int c = 0; c < 8; c++)
+        {
+            const Piece &p = board[r][c];
+            char upper = std::toupper(p.type);
+            if (upper == 'N' || upper == 'B')
+            {
+                material += 1;
+                bool homeRank = r == (p.isWhite ? 7 : 0);
+                bool homeFile = upper == 'N' ? (c == 1 || c == 6) : (c == 2 || c == 5);
+                if (homeRank && homeFile)
+                    undevelopedMinors++;
+            }
+            else if (upper == 'R')
+                material += 2;
+            else if (upper == 'Q')
+                material += 4;
+        }
+    }
+
+    if (material <= 8)
+        return PHASE_ENDGAME;
+    if (material >= 20 && undevelopedMinors >= 4)
+        return PHASE_OPENING;
+    return PHASE_MIDDLEGAME;
+}
+
+// ポーンとキング以外の駒を持っているか (ヌルムーブのツークツワンク対策)
+bool ChessGame::hasNonPawnMaterial(bool white) const
+{
+    for (int r = 0; r < 8; r++)
+    {
+        for (int c = 0; c < 8; c++)
+        {
+            const Piece &p = board[r][c];
+            char upper = std::toupper(p.type);
+            if (p.type != '*' && p.isWhite == white && upper != 'P' && upper != 'K')
+                return true;
+        }
+    }
+    return false;
+}
+
+// 取る手、アンパッサン、昇格か
+bool ChessGame::isTactical(const Move &move) const
+{
+    return board[move.to.first][move.to.second].type != '*' || move.isEnPassant || move.promotedTo != '*';
+}
+
+// ----------------------------------------------------------------------
+// 手順付けのスコア計算
+// ----------------------------------------------------------------------
+void ChessGame::scoreMoves(const std::vector<Move> &moves, std::vector<int> &scores,
+                           uint16_t pvMove, uint16_t ttMove, int ply, bool white) const
+{
+    scores.resize(moves.size());
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+        const Move &m = moves[i];
+        uint16_t packed = TranspositionTable::packMove(m);
+        const Piece &victim = board[m.to.first][m.to.second];
+
+        if (packed == pvMove)
+        {
+            scores[i] = ORDER_PV_MOVE;
+        }
+        else if (packed == ttMove)
+        {
+            scores[i] = ORDER_TT_MOVE;
+        }
+        else if (victim.type != '*' || m.isEnPassant || m.promotedTo != '*')
+        {
+            // MVV-LVA: 価値の高い駒を、価値の低い駒で取る手を優先する
+            // SEE で駒損と分かる取る手は、静かな手よりも後に回す
+            int victimValue = m.isEnPassant ? orderingValue('P') : orderingValue(victim.type);
+            int attackerValue = orderingValue(board[m.from.first][m.from.second].type);
+            int mvvLva = victimValue * 16 + orderingValue(m.promotedTo) - attackerValue / 100;
+            bool losing = m.promotedTo == '*' && isLosingCapture(m);
+            scores[i] = (losing ? -ORDER_CAPTURE : ORDER_CAPTURE) + mvvLva;
+        }
+        else if (ply < MAX_PLY && packed == killers_[ply][0])
+        {
+            scores[i] = ORDER_KILLER_1;
+        }
+        else if (ply < MAX_PLY && packed == killers_[ply][1])
+        {
+            scores[i] = ORDER_KILLER_2;
+        }
+        else
+        {
+            scores[i] = history_[white ? 0 : 1][squareIndex(m.from)][squareIndex(m.to)];
+        }
+    }
+}
+
+// ----------------------------------------------------------------------
+// beta カットを起こした静かな手をキラー手と history に記録する
+// ----------------------------------------------------------------------
+void ChessGame::updateQuietHeuristics(const Move &move, int depth, int ply, bool white)
+{
+    uint16_t packed = TranspositionTable::packMove(move);
+    if (ply < MAX_PLY && killers_[ply][0] != packed)
+    {
+        killers_[ply][1] = killers_[ply][0];
+        killers_[ply][0] = packed;
+    }
+
+    int &entry = history_[white ? 0 : 1][squareIndex(move.from)][squareIndex(move.to)];
+    entry += depth * depth;
+    if (entry > HISTORY_MAX)
+    {
+        // 飽和を防ぐため全体を半減する (相対的な順序は保たれる)
+        for (auto &side : history_)
+            for (auto &from : side)
+                for (int &value : from)
+                    value /= 2;
+    }
+}
+
+// 新しい探索の開始時: キラー手は局面依存なので消去し、history は半減して残す
+void ChessGame::resetHeuristics()
+{
+    for (auto &slots : killers_)
+    {
+        slots[0] = slots[1] = 0;
+    }
+    for (auto &side : history_)
+        for (auto &from : side)
+            for (int &value : from)
+                value /= 2;
+    prevPvLength_ = 0;
+    followPv_ = false;
+}
+
+// ----------------------------------------------------------------------
+// 三角形 PV テーブル
+// pvTable_[ply][ply..pvLength_[ply]) が ply のノードから先の読み筋。
+// alpha を更新した手の後ろに、子ノードの読み筋をつなげる
+// ----------------------------------------------------------------------
+void ChessGame::clearPv(int ply)
+{
+    if (ply < MAX_PLY)
+    {
+        pvLength_[ply] = ply;
+    }
+}
+
+void ChessGame::updatePv(int ply, uint16_t move)
+{
+    if (ply >= MAX_PLY)
+    {
+        return;
+    }
+    pvTable_[ply][ply] = move;
+    int childLength = ply + 1 < MAX_PLY ? pvLength_[ply + 1] : ply + 1;
+    for (int i = ply + 1; i < childLength; ++i)
+    {
+        pvTable_[ply][i] = pvTable_[ply + 1][i];
+    }
+    pvLength_[ply] = std::max(childLength, ply + 1);
+}
+
+// ----------------------------------------------------------------------
+// ルートの全手を指定深さで評価する (同点の手は tiedMoves に集める)
+// 完了したら moves を評価順 (良い手が先) に並べ替え、次の反復の手順付けに使う。
+// rootScores は並べ替え後の moves に対応する手番側視点の値で、先頭 multiPV 手は正確な値、
+// それ以降は上界になる。rootPvs は同じ順の読み筋 (packMove 形式。上界の手は手だけ)
+// prevScore は前の反復の評価値 (手番側視点)。NO_SCORE ならアスピレーションウィンドウを使わない
+// bestScore は白視点で返す。中断された場合は false を返す
+// ----------------------------------------------------------------------
+bool ChessGame::searchRoot(bool white, int depth, std::vector<Move> &moves, std::vector<int> &rootScores,
+                           std::vector<std::vector<uint16_t>> &rootPvs,
+                           int &bestScore, std::vector<Move> &tiedMoves, int prevScore)
+{
+    // 手番側から見た最善値
+    int best = -MATE_SCORE;
+    tiedMoves.clear();
+    // 手ごとの値と読み筋は反復の間で使い回す領域に書く (反復ごとに確保しないように)
+    std::vector<int> &scores = rootScratch_.scores;
+    scores.clear();
+    std::vector<std::vector<uint16_t>> &pvs = rootScratch_.pvs;
+    if (pvs.size() < moves.size())
+        pvs.resize(moves.size());
+
+    // Multi-PV: 上位 multiPV 手の正確な値 (降順)。multiPV 番目の値を超えた手だけを全幅で読み直す
+    size_t multiPV = std::min(moves.size(), static_cast<size_t>(std::max(1, options_.multiPV)));
+    std::vector<int> &topScores = rootScratch_.topScores;
+    topScores.clear();
+
+    for (size_t moveIndex = 0; moveIndex < moves.size(); ++moveIndex)
+    {
+        const Move &move = moves[moveIndex];
+        Move currentMove = move; // Moveをコピーし、Undo情報を記録する準備
+
+        // 1. 移動を実行 (参照渡しで currentMove に Undo情報が記録される)
+        // NOTE: AI探索のルートノードでは、makeMove と同じく history を更新する
+        makeRootMove(currentMove, !white);
+
+        // 2. negamax で評価
+        // 最初の手は全幅で読む (Multi-PV では上位 multiPV 手になるまで全幅)。以降は同点を検出
+        // できるよう、ヌルウィンドウではなく幅2の窓 (threshold-1, threshold+1) で読み、
+        // threshold (multiPV 番目の値) を上回った場合だけ全幅で再探索する
+        int score;
+        if (tiedMoves.empty())
+        {
+            uint64_t nodesBefore = nodes_;
+            score = searchAspiration(white, depth, prevScore, move);
+            firstRootMoveNodes_ = nodes_ - nodesBefore;
+        }
+        else if (topScores.size() < multiPV)
+        {
+            score = -searchChild(depth - 1, 1, !white, -MATE_SCORE, MATE_SCORE, &move, moveIndex, 0);
+        }
+        else
+        {
+            int threshold = topScores.back();
+            score = -searchChild(depth - 1, 1, !white, -(threshold + 1), -(threshold - 1), &move, moveIndex, 0);
+            if (score > threshold)
+            {
+                score = -searchChild(depth - 1, 1, !white, -MATE_SCORE, -threshold, &move, moveIndex,
+                                     TREE_PVS_RESEARCH);
+            }
+        }
+
+        // 3. 移動を元に戻す (Undo情報が記録された currentMove を使用)
+        undoRootMove(currentMove);
+
+        if (isAborted())
+        {
+            // 読み終えた手までの結果を返す
+            bestScore = white ? best : -best;
+            return false;
+        }
+        // threshold を下回った手の値は上界でしかないが、手順付けには十分
+        scores.push_back(score);
+        // 正確な値が出た手 (threshold と同点の手を含む) は、子ノードの読み筋をつなげて保存する
+        std::vector<uint16_t> &pv = pvs[moveIndex];
+        pv.assign(1, TranspositionTable::packMove(move));
+        if (topScores.size() < multiPV || score >= topScores.back())
+        {
+            pv.insert(pv.end(), pvTable_[1] + 1, pvTable_[1] + pvLength_[1]);
+        }
+        if (topScores.size() < multiPV || score > topScores.back())
+        {
+            topScores.insert(std::upper_bound(topScores.begin(), topScores.end(), score, std::greater<int>()), score);
+            if (topScores.size() > multiPV)
+                topScores.pop_back();
+        }
+
+        if (score > best || tiedMoves.empty())
+        {
+            // 前の反復の最善手 (最初に読む手) より良い手が見つかった
+            if (!tiedMoves.empty() && enforceLimits_ && SearchTrace::enabled())
+                SearchTrace::instant("root move change", {"depth", depth}, {"score", white ? score : -score}, {},
+                                     moveToAlgebratic(move).c_str());
+            best = score;
+            tiedMoves.clear();
+            tiedMoves.push_back(move);
+        }
+        else if (score == best)
+        {
+            tiedMoves.push_back(move);
+        }
+    }
+
+    // 4. 手番側から見て良い順に並べ替える (同点は元の順序を保つ)
+    std::vector<size_t> &order = rootScratch_.order;
+    order.resize(moves.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    // std::stable_sort は作業領域を確保するので、同点は添字で順序を決める
+    std::sort(order.begin(), order.end(),
+              [&scores](size_t a, size_t b)
+              { return scores[a] != scores[b] ? scores[a] > scores[b] : a < b; });
+    std::vector<Move> &sorted = rootScratch_.moves;
+    sorted.clear();
+    rootScores.clear();
+    rootPvs.resize(moves.size());
+    for (size_t k = 0; k < order.size(); ++k)
+    {
+        sorted.push_back(moves[order[k]]);
+        rootScores.push_back(scores[order[k]]);
+        rootPvs[k].swap(pvs[order[k]]); // 読み筋の領域ごと入れ替える (入れ替えた側は次の反復で使う)
+    }
+    moves.swap(sorted);
+
+    // 最善の読み筋を次の反復で最初に読む
+    prevPvLength_ = static_cast<int>(std::min(rootPvs.front().size(), static_cast<size_t>(MAX_PLY)));
+    std::copy(rootPvs.front().begin(), rootPvs.front().begin() + prevPvLength_, prevPv_);
+
+    bestScore = white ? best : -best;
+    return true;
+}
+
+// ----------------------------------------------------------------------
+// ルートの最初の手 (PVの候補) をアスピレーションウィンドウで読む
+// 前の反復の評価値を中心とした狭い窓から始め、fail-low/fail-high のたびに
+// 外れた側だけを段階的に広げて読み直す (呼び出し前に手は指してある)
+// ----------------------------------------------------------------------
+int ChessGame::searchAspiration(bool white, int depth, int prevScore, const Move &move)
+{
+    // 最初の手は前の反復の最善手なので、その読み筋をたどって読む (読み直しのたびに)
+    int delta = options_.aspirationWindow;
+    if (delta <= 0 || prevScore == NO_SCORE || std::abs(prevScore) >= MATE_BOUND)
+    {
+        followPv_ = true;
+        return -searchChild(depth - 1, 1, !white, -MATE_SCORE, MATE_SCORE, &move, 0, 0);
+    }
+
+    int alpha = std::max(prevScore - delta, -MATE_SCORE);
+    int beta = std::min(prevScore + delta, MATE_SCORE);
+    uint8_t treeFlags = 0;
+    while (true)
+    {
+        followPv_ = true;
+        int score = -searchChild(depth - 1, 1, !white, -beta, -alpha, &move, 0, treeFlags);
+        treeFlags = TREE_ASPIRATION_RESEARCH;
+        if (isAborted())
+        {
+            return score;
+        }
+
+        if (score <= alpha && alpha > -MATE_SCORE)
+        {
+            stats_.aspirationFailLows++;
+            delta *= 2;
+            alpha = delta > ASPIRATION_MAX_DELTA ? -MATE_SCORE : std::max(score - delta, -MATE_SCORE);
+        }
+        else if (score >= beta && beta < MATE_SCORE)
+        {
+            stats_.aspirationFailHighs++;
+            delta *= 2;
+            beta = delta > ASPIRATION_MAX_DELTA ? MATE_SCORE : std::min(score + delta, MATE_SCORE);
+        }
+        else
+        {
+            return score;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------
+// 完了した反復のルートの上位 multiPV 手を読み筋にまとめる
+// ----------------------------------------------------------------------
+void ChessGame::collectLines(bool white, const std::vector<Move> &moves, const std::vector<int> &rootScores,
+                             const std::vector<std::vector<uint16_t>> &rootPvs, int depth,
+                             std::vector<SearchLine> &lines)
+{
+    size_t count = std::min(moves.size(), static_cast<size_t>(std::max(1, options_.multiPV)));
+    lines.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        lines[i].score = white ? rootScores[i] : -rootScores[i];
+        unpackLine(white, rootPvs[i], depth, lines[i].pv);
+    }
+}
+
+// ----------------------------------------------------------------------
+// packMove 形式の読み筋を、合法手と照合しながら指して Move の列に戻す
+// PV テーブルの読み筋が置換表のカットで途中までしか無い場合は、置換表の最善手で
+// maxLength 手まで補う。line の領域は使い回す (合法手は ply ごとのバッファに生成する)
+// ----------------------------------------------------------------------
+void ChessGame::unpackLine(bool white, const std::vector<uint16_t> &packed, int maxLength, std::vector<Move> &line)
+{
+    line.clear();
+    bool side = white;
+    for (uint16_t code : packed)
+    {
+        if (line.size() >= static_cast<size_t>(MAX_PLY))
+            break;
+        std::vector<Move> &legal = moveLists_[line.size()];
+        generateMoves(side, false, legal);
+        auto it = std::find_if(legal.begin(), legal.end(), [code](const Move &candidate)
+                               { return TranspositionTable::packMove(candidate) == code; });
+        if (it == legal.end())
+            break;
+        line.push_back(*it);
+        makeMoveInternal(line.back());
+        side = !side;
+    }
+
+    Move next;
+    while (static_cast<int>(line.size()) < std::min(maxLength, MAX_PLY) &&
+           hashMove(side, next, moveLists_[line.size()]))
+    {
+        line.push_back(next);
+        makeMoveInternal(line.back());
+        side = !side;
+    }
+
+    for (auto it = line.rbegin(); it != line.rend(); ++it)
+    {
+        unmakeMoveInternal(*it);
+    }
+}
+
+// ----------------------------------------------------------------------
+// ヘルパーの局面と探索の設定をメインスレッドに合わせる (search() の開始時)
+// 手順付けのバッファや読み筋の表は確保済みのものをそのまま使う
+// ----------------------------------------------------------------------
+void ChessGame::prepareHelper(const ChessGame &main)
+{
+    std::copy(&main.board[0][0], &main.board[0][0] + 64, &board[0][0]);
+    castlingRights = main.castlingRights;
+    enPassantSquare_ = main.enPassantSquare_;
+    halfMoveClock_ = main.halfMoveClock_;
+    fullMoveNumber_ = main.fullMoveNumber_;
+    position_history_ = main.position_history_;
+    tt_ = main.tt_;
+    hashKey_ = main.hashKey_;
+    options_ = main.options_;
+
+    activeLimits_ = main.activeLimits_;
+    searchStart_ = main.searchStart_;
+    enforceLimits_ = false;
+    pondering_ = false;
+    rootDepth_ = 0;
+    treeLog_ = nullptr;
+    nodes_ = 0;
+    stats_ = SearchStats();
+
+    // 手順付けと前の反復の読み筋はメインスレッドの探索開始時の状態から始める
+    std::copy(&main.killers_[0][0], &main.killers_[0][0] + MAX_PLY * 2, &killers_[0][0]);
+    std::copy(&main.history_[0][0][0], &main.history_[0][0][0] + 2 * 64 * 64, &history_[0][0][0]);
+    std::copy(main.prevPv_, main.prevPv_ + MAX_PLY, prevPv_);
+    prevPvLength_ = main.prevPvLength_;
+    followPv_ = false;
+}
+
+// ----------------------------------------------------------------------
+// Lazy SMP のヘルパースレッド
+// メインスレッドと同じルートを、深さと手順を少しずらして探索し、
+// 結果は共有の置換表経由でメインスレッドに渡す (返り値は使わない)
+// ----------------------------------------------------------------------
+void ChessGame::helperSearch(int helperId, bool white, std::vector<Move> moves)
+{
+    // ヘルパーごとにルートの手順を回転させ、異なる部分木から探索を始める
+    std::rotate(moves.begin(), moves.begin() + helperId % moves.size(), moves.end());
+
+    // 奇数番のヘルパーは1手深く読む
+    // (先読み中は ponder hit 後の深さが分からないので上限まで読む)
+    int maxDepth = (activeLimits_.depth > 0 && !activeLimits_.ponder ? activeLimits_.depth : MAX_SEARCH_DEPTH) +
+                   (helperId & 1);
+
+    int score;
+    int prevScore = NO_SCORE;
+    std::vector<Move> tiedMoves;
+    std::vector<int> rootScores;
+    std::vector<std::vector<uint16_t>> rootPvs;
+    SearchTrace::setThreadName("helper " + std::to_string(helperId));
+    SearchTrace::begin("helper", {"id", helperId});
+    for (int depth = 1 + (helperId & 1); depth <= maxDepth; ++depth)
+    {
+        SearchTrace::begin("iteration", {"depth", depth});
+        bool completed = searchRoot(white, depth, moves, rootScores, rootPvs, score, tiedMoves, prevScore);
+        SearchTrace::end("iteration", {"depth", depth}, {"aborted", completed ? 0 : 1});
+        if (!completed)
+            break;
+        prevScore = white ? score : -score;
+    }
+    SearchTrace::end("helper", {"id", helperId});
+}
+
+// ----------------------------------------------------------------------
+// ノードの計上 (negamax/quiescence の入口)
+// メインスレッドは制限を監視し、ヘルパーは途中経過用の合計に一定間隔でまとめて加算する
+// ----------------------------------------------------------------------
+void ChessGame::countNode()
+{
+    nodes_++;
+    if (enforceLimits_)
+    {
+        checkLimits();
+    }
+    else if (helperNodes_ && (nodes_ & (STOP_CHECK_INTERVAL - 1)) == 0)
+    {
+        helperNodes_->fetch_add(STOP_CHECK_INTERVAL, std::memory_order_relaxed);
+    }
+}
+
+// ----------------------------------------------------------------------
+// 探索制限の監視 (メインスレッドの negamax/quiescence から毎ノード呼ばれる)
+// ----------------------------------------------------------------------
+void ChessGame::checkLimits()
+{
+    bool poll = (nodes_ & (STOP_CHECK_INTERVAL - 1)) == 0;
+
+    // ponder hit 前は停止要求だけを監視する
+    if (pondering_)
+    {
+        if (!poll)
+            return;
+        checkPonderHit();
+        if (pondering_)
+        {
+            if (activeLimits_.stop.requested())
+                stop_->store(true, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    // 深さ1の反復中はノード数/時間の制限を適用しない
+    // (ponder hit の時点で制限より深い反復を読んでいれば、すぐに打ち切る)
+    bool limitsActive = rootDepth_ > 1;
+    bool exceeded = limitsActive &&
+                    ((activeLimits_.nodes > 0 && nodes_ >= activeLimits_.nodes) ||
+                     (activeLimits_.depth > 0 && rootDepth_ > activeLimits_.depth));
+
+    // 停止要求と時計の読み出しは STOP_CHECK_INTERVAL ノードごと
+    if (!exceeded && poll)
+    {
+        exceeded = activeLimits_.stop.requested() ||
+                   (limitsActive && activeLimits_.timeMs > 0 &&
+                    elapsedMs() - ponderHitMs_ >= activeLimits_.timeMs);
+    }
+
+    if (exceeded)
+    {
+        stop_->store(true, std::memory_order_relaxed);
+    }
+}
+
+// ----------------------------------------------------------------------
+// ponder hit の確認。予想手が指されていたら通常の探索に切り替える
+// ----------------------------------------------------------------------
+void ChessGame::checkPonderHit()
+{
+    if (pondering_ && activeLimits_.ponderHit.requested())
+    {
+        pondering_ = false;
+        ponderHitMs_ = elapsedMs();
+    }
+}
+
+int64_t ChessGame::elapsedMs() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - searchStart_)
+        .count();
+}
+
+Move ChessGame::bestMove(bool white)
+{
+    // 停止フラグは探索ごとに作る (limits_ のコピーを渡した別の探索の停止が残らないように)
+    SearchLimits limits = limits_;
+    limits.stop = StopToken();
+    return search(white, limits).bestMove;
+}
+
+const MoveLatencyStats &ChessGame::moveLatency() const
+{
+    return *moveLatency_;
+}
+
+void ChessGame::resetMoveLatency()
+{
+    moveLatency_->reset();
+}
+
+// ----------------------------------------------------------------------
+// 反復深化探索
+// 深さ1から順に探索し、制限に達したら最後に完了した反復の最善手を返す
+// ----------------------------------------------------------------------
+SearchResult ChessGame::search(bool white, const SearchLimits &limits,
+                               const SearchProgressCallback &onProgress)
+{
+    SearchResult result;
+
+    // 応答時間は合法手生成やヘルパーの準備も含めて測る (記録は探索の最後)
+    auto callStart = std::chrono::steady_clock::now();
+    GamePhase phase = gamePhase();
+
+    auto moves = generateMoves(white);
+    if (moves.empty())
+    {
+        return result;
+    }
+
+    SearchTrace::setThreadName("search");
+    SearchTrace::begin("search", {"threads", threads_}, {"depthLimit", limits.depth});
+
+    // 決定的モード: 前の探索の置換表と history を持ち越さない
+    // (スレッド数1なら、同じ局面・同じ制限で常に同じ手とノード数になる)
+    if (options_.deterministic)
+    {
+        tt_->clear();
+        std::fill(&history_[0][0][0], &history_[0][0][0] + sizeof(history_) / sizeof(int), 0);
+    }
+    tt_->newSearch();
+    resetHeuristics();
+    activeLimits_ = limits;
+    searchStart_ = std::chrono::steady_clock::now();
+    nodes_ = 0;
+    stats_ = SearchStats();
+
+    // 持ち時間があれば、ハードリミットを反復途中の時間制限として使う
+    timeManager_.init(limits, moves.size());
+    if (timeManager_.active() &&
+        (activeLimits_.timeMs <= 0 || timeManager_.hardLimitMs() < activeLimits_.timeMs))
+    {
+        activeLimits_.timeMs = timeManager_.hardLimitMs();
+    }
+
+    // =======================================================
+    // 1. ヘルパースレッドの起動 (Lazy SMP)
+    // =======================================================
+    // 各ヘルパーは盤面のコピーを持ち、置換表だけを共有する
+    std::atomic<bool> stopMain(false);
+    std::atomic<bool> stopHelpers(false);
+    std::atomic<uint64_t> helperNodes(0);
+    std::vector<std::unique_ptr<ChessGame>> &helperGames = helpers_.games;
+    helperGames.resize(std::max(0, threads_ - 1));
+    std::vector<std::thread> helpers;
+    for (size_t i = 0; i < helperGames.size(); ++i)
+    {
+        if (!helperGames[i])
+            helperGames[i] = std::make_unique<ChessGame>(*this);
+        ChessGame &helper = *helperGames[i];
+        helper.prepareHelper(*this);
+        helper.stop_ = &stopHelpers;
+        helper.helperNodes_ = &helperNodes;
+        helpers.emplace_back(&ChessGame::helperSearch, &helper, static_cast<int>(i + 1), white, moves);
+    }
+
+    // =======================================================
+    // 2. メインスレッドの反復深化
+    // =======================================================
+    // 浅い反復の結果 (ルートの手順と置換表の最善手) が次の深さの手順付けに使われる
+    stop_ = &stopMain;
+    enforceLimits_ = true;
+    pondering_ = limits.ponder;
+    ponderHitMs_ = 0;
+    int maxDepth = limits.depth > 0 ? std::min(limits.depth, MAX_SEARCH_DEPTH) : MAX_SEARCH_DEPTH;
+    std::vector<Move> tiedMoves;
+    std::vector<Move> iterationTied;
+    std::vector<int> rootScores;
+    std::vector<std::vector<uint16_t>> rootPvs;
+    int partialDepth = 0; // 中断された反復の手を採用したときの、その反復の深さ
+    stats_.iterations.reserve(MAX_SEARCH_DEPTH);
+    for (int depth = 1; !limits.stop.requested(); ++depth)
+    {
+        // 先読み中は深さの制限を適用しない
+        checkPonderHit();
+        if (depth > (pondering_ ? MAX_SEARCH_DEPTH : maxDepth))
+        {
+            break;
+        }
+        rootDepth_ = depth;
+        uint64_t iterationStartNodes = nodes_;
+        uint64_t failLowsBefore = stats_.aspirationFailLows;
+        SearchTrace::begin("iteration", {"depth", depth});
+
+        int score;
+        int prevScore = depth == 1 ? NO_SCORE : (white ? result.score : -result.score);
+        if (!searchRoot(white, depth, moves, rootScores, rootPvs, score, iterationTied, prevScore))
+        {
+            // 中断された反復でも、読み終えた手の中の最善手はより深い読みに基づく。
+            // ルートは前の反復の最善手から読むので、1手でも読み終えていればそれを採用する
+            // (読み筋もこの反復のものに差し替える。moves はこの反復で読んだ順のまま)
+            if (!iterationTied.empty())
+            {
+                tiedMoves.swap(iterationTied);
+                result.score = score;
+                partialDepth = depth;
+            }
+            result.stopped = true;
+            SearchTrace::end("iteration", {"depth", depth}, {"aborted", 1});
+            break;
+        }
+        tiedMoves.swap(iterationTied);
+        result.score = score;
+        result.depth = depth;
+        collectLines(white, moves, rootScores, rootPvs, depth, result.lines);
+
+        IterationStats iteration;
+        iteration.depth = depth;
+        iteration.nodes = nodes_ - iterationStartNodes;
+        iteration.timeMs = elapsedMs();
+        if (!stats_.iterations.empty() && stats_.iterations.back().nodes > 0)
+            iteration.branching = static_cast<double>(iteration.nodes) / stats_.iterations.back().nodes;
+        stats_.iterations.push_back(iteration);
+        SearchTrace::end("iteration", {"depth", depth}, {"score", score},
+                         {"nodes", static_cast<int64_t>(iteration.nodes)});
+
+        if (onProgress)
+        {
+            SearchInfo info;
+            info.depth = depth;
+            info.score = score;
+            info.nodes = nodes_ + helperNodes.load(std::memory_order_relaxed);
+            info.timeMs = elapsedMs();
+            info.nps = info.nodes * 1000 / static_cast<uint64_t>(std::max<int64_t>(1, info.timeMs));
+            info.pv = result.lines.front().pv;
+            info.lines = result.lines;
+            onProgress(info);
+        }
+
+        // 次の反復を始める前に制限を確認する
+        // (時間管理は ponder hit 前も反復ごとの状態を更新するが、止めるのは hit 後だけ)
+        checkPonderHit();
+        uint64_t iterationNodes = std::max<uint64_t>(1, nodes_ - iterationStartNodes);
+        bool timeUp = timeManager_.iterationDone(
+            elapsedMs() - ponderHitMs_, TranspositionTable::packMove(moves.front()), white ? score : -score,
+            stats_.aspirationFailLows > failLowsBefore, static_cast<double>(firstRootMoveNodes_) / iterationNodes);
+        if (!pondering_ &&
+            (timeUp || (activeLimits_.timeMs > 0 && elapsedMs() - ponderHitMs_ >= activeLimits_.timeMs) ||
+             (limits.nodes > 0 && nodes_ >= limits.nodes)))
+        {
+            break;
+        }
+    }
+    stop_ = nullptr;
+    enforceLimits_ = false;
+    bool ponderMissed = pondering_; // ponder hit の前に止められた (予想が外れた)
+    pondering_ = false;
+    rootDepth_ = 0;
+
+    // =======================================================
+    // 3. ヘルパーの停止
+    // =======================================================
+    stopHelpers = true;
+    for (auto &helper : helpers)
+    {
+        helper.join();
+    }
+
+    result.nodes = nodes_;
+    result.stats = stats_;
+    for (const auto &helper : helperGames)
+    {
+        result.nodes += helper->nodes_;
+        result.stats += helper->stats_;
+        helper->stop_ = nullptr;
+        helper->helperNodes_ = nullptr;
+    }
+    result.timeMs = elapsedMs();
+
+    if (!tiedMoves.empty())
+    {
+        // 決定的モードではルートの手順 (前の反復の評価順) で先頭の手を選ぶ
+        size_t pick = options_.deterministic
+                          ? 0
+                          : std::uniform_int_distribution<size_t>(0, tiedMoves.size() - 1)(rng_);
+        result.bestMove = tiedMoves[pick];
+    }
+    else
+    {
+        // 深さ1の最初の手を読み終える前に止められた場合
+        result.bestMove = moves.front();
+    }
+
+    // 選んだ手の読み筋 (同点の手も正確な値なので、読み筋が保存されている)
+    // 中断された反復の手を採用した場合は、その反復で保存した読み筋を使う
+    const std::vector<std::vector<uint16_t>> &chosenPvs = partialDepth > 0 ? rootScratch_.pvs : rootPvs;
+    auto chosen = std::find(moves.begin(), moves.end(), result.bestMove);
+    size_t chosenIndex = static_cast<size_t>(chosen - moves.begin());
+    std::vector<uint16_t> packedPv = chosenIndex < chosenPvs.size()
+                                         ? chosenPvs[chosenIndex]
+                                         : std::vector<uint16_t>(1, TranspositionTable::packMove(result.bestMove));
+    unpackLine(white, packedPv, std::max(1, partialDepth > 0 ? partialDepth : result.depth), result.pv);
+
+    // lines の先頭を最善手・評価値と同じ反復の読み筋にそろえる (中断された反復の手を採用した場合と、
+    // 同点の手から先頭以外を選んだ場合)。Multi-PV の残りは完了した反復のものなので、同じ手で始まる行は除く
+    bool lineMismatch = !result.lines.empty() && (result.lines.front().pv.empty() ||
+                                                  !(result.lines.front().pv.front() == result.bestMove));
+    if (partialDepth > 0 || lineMismatch)
+    {
+        for (size_t i = 1; i < result.lines.size(); ++i)
+            if (!result.lines[i].pv.empty() && result.lines[i].pv.front() == result.bestMove)
+            {
+                result.lines.erase(result.lines.begin() + static_cast<std::ptrdiff_t>(i));
+                break;
+            }
+        if (result.lines.empty())
+            result.lines.resize(1);
+        result.lines.front().score = result.score;
+        result.lines.front().pv = result.pv;
+    }
+
+    // 応答時間 (bestMove/runGame/searchAsync/Ponderer のすべてがここを通る)
+    // 先読みは ponder hit からの時間だけを数え、外れた先読みは指し手を返さないので記録しない
+    if (!ponderMissed)
+    {
+        int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - callStart)
+                         .count() -
+                     ponderHitMs_ * 1000;
+        moveLatency_->record(phase, std::max<int64_t>(0, us), getBoardStateFEN(white));
+    }
+    SearchTrace::end("search", {"depth", result.depth}, {"nodes", static_cast<int64_t>(result.nodes)});
+    return result;
+}
+
+// ----------------------------------------------------------------------
+// 非同期探索
+// 盤面のコピーを探索スレッドに渡し、結果は SearchHandle の future で受け取る
+// ----------------------------------------------------------------------
+SearchHandle ChessGame::searchAsync(bool white, const SearchLimits &limits,
+                                    SearchProgressCallback onProgress,
+                                    SearchFinishedCallback onFinished) const
+{
+    std::promise<SearchResult> promise;
+    std::future<SearchResult> future = promise.get_future();
+
+    // 停止フラグは探索ごとに作り、ハンドルだけが持つ。呼び出し元の limits (searchLimits() のコピーなど)
+    // と共有すると、cancel() したフラグが残って以後の探索がすぐに終わってしまう
+    SearchLimits searchLimits = limits;
+    searchLimits.stop = StopToken();
+
+    std::thread thread(
+        [game = *this, white, limits = searchLimits, onProgress = std::move(onProgress),
+         onFinished = std::move(onFinished), promise = std::move(promise)]() mutable
+        {
+            try
+            {
+                SearchResult result = game.search(white, limits, onProgress);
+                if (onFinished)
+                {
+                    onFinished(result);
+                }
+                promise.set_value(result);
+            }
+            catch (...)
+            {
+                promise.set_exception(std::current_exception());
+            }
+        });
+
+    return SearchHandle(std::move(thread), std::move(future), searchLimits.stop);
+}
+
+void ChessGame::setSearchOptions(const SearchOptions &options)
+{
+    options_ = options;
+}
+
+const SearchOptions &ChessGame::searchOptions() const
+{
+    return options_;
+}
+
+void ChessGame::setSearchLimits(const SearchLimits &limits)
+{
+    limits_ = limits;
+}
+
+const SearchLimits &ChessGame::searchLimits() const
+{
+    return limits_;
+}
+
+void ChessGame::setSeed(uint64_t seed)
+{
+    rng_.seed(seed);
+}
+
+void ChessGame::setTimeControl(int64_t baseMs, int64_t incrementMs, int movesPerControl)
+{
+    clockBaseMs_ = std::max<int64_t>(0, baseMs);
+    clockIncrementMs_ = std::max<int64_t>(0, incrementMs);
+    clockMovesPerControl_ = std::max(0, movesPerControl);
+}
+
+void ChessGame::setPonder(bool enabled)
+{
+    ponder_ = enabled;
+}
+
+bool ChessGame::ponder() const
+{
+    return ponder_;
+}
+
+// ----------------------------------------------------------------------
+// スレッド数の設定
+// ----------------------------------------------------------------------
+void ChessGame::setThreads(int threads)
+{
+    threads_ = std::clamp(threads, 1, MAX_SEARCH_THREADS);
+}
+
+int ChessGame::threads() const
+{
+    return threads_;
+}
+
+void ChessGame::setTreeLog(TreeLog *log)
+{
+    treeLog_ = log;
+}
+
+// -------------------------------------------------------------
+// メインルーチン (初期化と入力/ゲーム実行)
+// -------------------------------------------------------------
+
 void ChessGame::initBoard()
 {
     std::string rows[8] = {
@@ -1284,6 +2855,8 @@ void ChessGame::initBoard()
         }
     }
     castlingRights = {}; // 構造体のリセット
+    enPassantSquare_ = {-1, -1};
+    hashKey_ = computeHashKey();
 }
 // ----------------------------------------------------------------------
 // プレイヤーからの入力を受け付け、Moveオブジェクトに変換する
@@ -1360,10 +2933,64 @@ Move ChessGame::ask(bool turnWhite)
 void ChessGame::runGame()
 {
     std::cout << "--- Full Chess (Minimax AI): Human (White) vs AI (Black) ---\n";
-    std::cout << "AI Depth: " << MAX_DEPTH << " (3-ply search).\n";
+    if (clockBaseMs_ > 0)
+    {
+        std::cout << "AI Clock: " << clockBaseMs_ / 1000.0 << " s + " << clockIncrementMs_ / 1000.0 << " s";
+        if (clockMovesPerControl_ > 0)
+            std::cout << " / " << clockMovesPerControl_ << " moves";
+        std::cout << "\n";
+    }
+    else
+    {
+        std::cout << "AI Depth: " << limits_.depth << " (" << limits_.depth - 1 << "-ply search).\n";
+    }
+    std::cout << "Hash: " << hashSizeMB() << " MB (huge pages: " << (hashUsesHugePages() ? "yes" : "no") << ")\n";
+    std::cout << "Ponder: " << (ponder_ ? "on" : "off") << "\n";
     std::cout << "Note: En Passant is NOT implemented. (Promotion and Checkmate/Stalemate are included.)\n";
     printBoard();
 
+    // AI の反復ごとの途中経過を表示する
+    // (Multi-PV では読み筋ごとに1行)
+    auto printProgress = [this](const SearchInfo &info)
+    {
+        for (size_t i = 0; i < info.lines.size(); ++i)
+        {
+            std::cout << "  depth " << info.depth;
+            if (info.lines.size() > 1)
+            {
+                std::cout << " multipv " << i + 1;
+            }
+            std::cout << " score " << info.lines[i].score
+                      << " nodes " << info.nodes << " nps " << info.nps << " pv";
+            for (const Move &m : info.lines[i].pv)
+            {
+                std::cout << ' ' << moveToAlgebratic(m);
+            }
+            std::cout << "\n";
+        }
+    };
+
+    // ユーザーの手番中の先読み
+    Ponderer ponderer;
+    bool ponderHit = false;
+    SearchResult aiResult;
+
+    // AI の持ち時間 (setTimeControl() されていれば、深さの代わりに時間管理で指す)
+    int64_t aiClockMs = clockBaseMs_;
+    int aiMovesPlayed = 0;
+    auto aiLimits = [&]()
+    {
+        SearchLimits limits = limits_;
+        if (clockBaseMs_ > 0)
+        {
+            limits.depth = 0;
+            limits.remainingMs = aiClockMs;
+            limits.incrementMs = clockIncrementMs_;
+            limits.movesToGo = clockMovesPerControl_ > 0 ? clockMovesPerControl_ - aiMovesPlayed % clockMovesPerControl_ : 0;
+        }
+        return limits;
+    };
+
     bool turnWhite = true;
     for (int step = 0; step < 100; step++)
     {
@@ -1406,11 +3033,48 @@ void ChessGame::runGame()
         if (turnWhite)
         {
             move = ask(turnWhite); // ユーザー (白) の手
+            ponderHit = ponderer.opponentMoved(move);
         }
         else
         {
-            std::cout << "AI (Black) is thinking...\n";
-            move = bestMove(turnWhite); // AI (黒) の手
+            auto thinkStart = std::chrono::steady_clock::now();
+            if (ponderHit)
+            {
+                // 予想どおりの手だったので、先読みしていた探索の結果を使う
+                std::cout << "AI (Black) ponder hit.\n";
+                aiResult = ponderer.wait();
+            }
+            else
+            {
+                std::cout << "AI (Black) is thinking...\n";
+                aiResult = search(turnWhite, aiLimits(), printProgress); // AI (黒) の手
+            }
+            move = aiResult.bestMove;
+
+            std::cout << "PV:";
+            for (const Move &m : aiResult.pv)
+            {
+                std::cout << ' ' << moveToAlgebratic(m);
+            }
+            std::cout << "\n";
+
+            if (clockBaseMs_ > 0)
+            {
+                // 使った時間を引き、加算時間 (と規定手数に達したら次の持ち時間) を足す
+                aiClockMs -= std::chrono::duration_cast<std::chrono::milliseconds>(
+                                 std::chrono::steady_clock::now() - thinkStart)
+                                 .count();
+                if (aiClockMs <= 0)
+                {
+                    std::cout << "\n*** White WINS on time! ***\n";
+                    break;
+                }
+                aiClockMs += clockIncrementMs_;
+                aiMovesPlayed++;
+                if (clockMovesPerControl_ > 0 && aiMovesPlayed % clockMovesPerControl_ == 0)
+                    aiClockMs += clockBaseMs_;
+                std::cout << "AI Clock: " << aiClockMs / 1000.0 << " s\n";
+            }
         }
 
         // 3. 指し手の表示、適用、ターン切替
@@ -1425,11 +3089,20 @@ void ChessGame::runGame()
 
         makeMove(move);
         printBoard();
+
+        // AI が指したら、ユーザーの予想手に対する AI の応手を裏で読み始める
+        if (!turnWhite && ponder_)
+        {
+            ponderer.start(*this, turnWhite, aiLimits(), aiResult.pv);
+        }
         turnWhite = !turnWhite;
     }
 
     std::cout << "\nGame finished.\n";
-    std::cout << "Final Evaluation (White's perspective): " << evaluate() << std::endl;
+    std::cout << "Final Evaluation (White's perspective): " << evaluate() << "\n";
+    // この対局の AI の手ごとの応答時間 (先読みは ponder hit から数える)
+    std::cout << "\nAI move latency\n"
+              << moveLatency().report() << std::flush;
 }
 
 //! new
@@ -1457,6 +3130,74 @@ void ChessGame::initBoardWithStrings(const std::string rows[8])
     }
     // キャスリング権を初期状態にリセット (より厳密には引数で受け取るべき)
     castlingRights = {};
+    enPassantSquare_ = {-1, -1};
+    hashKey_ = computeHashKey();
+}
+
+/**
+ * FEN 文字列で盤面・手番・キャスリング権・アンパッサンマス・手数を設定する
+ * 手数のフィールドは省略してよい。形式が不正な場合は盤面を変更せずに false を返す
+ */
+bool ChessGame::initBoardWithFEN(const std::string &fen, bool &turnWhite)
+{
+    std::istringstream iss(fen);
+    std::string placement, side, castling = "-", enPassant = "-";
+    int halfMoveClock = 0, fullMoveNumber = 1;
+    if (!(iss >> placement >> side))
+    {
+        return false;
+    }
+    iss >> castling >> enPassant >> halfMoveClock >> fullMoveNumber;
+
+    // 1. 盤面 (8段を '/' で区切り、数字は空きマスの数)
+    std::string rows[8];
+    int r = 0;
+    for (char ch : placement)
+    {
+        if (ch == '/')
+        {
+            if (rows[r].size() != 8 || ++r >= 8)
+                return false;
+        }
+        else if (std::isdigit(static_cast<unsigned char>(ch)))
+        {
+            rows[r].append(ch - '0', '*');
+        }
+        else if (std::strchr("PNBRQKpnbrqk", ch))
+        {
+            rows[r] += ch;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    if (r != 7 || rows[7].size() != 8 || (side != "w" && side != "b"))
+    {
+        return false;
+    }
+
+    initBoardWithStrings(rows);
+    turnWhite = side == "w";
+
+    // 2. キャスリング権 (記載の無い側は、キングかルークが動いたものとして扱う)
+    castlingRights.whiteRookKSidesMoved = castling.find('K') == std::string::npos;
+    castlingRights.whiteRookQSidesMoved = castling.find('Q') == std::string::npos;
+    castlingRights.blackRookKSidesMoved = castling.find('k') == std::string::npos;
+    castlingRights.blackRookQSidesMoved = castling.find('q') == std::string::npos;
+
+    // 3. アンパッサンマス
+    int epRow, epCol;
+    if (enPassant != "-" && algebraicToCoords(enPassant, epRow, epCol))
+    {
+        enPassantSquare_ = {epRow, epCol};
+    }
+
+    halfMoveClock_ = halfMoveClock;
+    fullMoveNumber_ = fullMoveNumber;
+    position_history_.clear();
+    hashKey_ = computeHashKey();
+    return true;
 }
 
 // -------------------------------------------------------------
@@ -1671,4 +3412,75 @@ bool ChessGame::isPromotionMove(Move move)
     int promoR = isWhite ? 0 : 7; // 白:1段目(0), 黒:8段目(7)
 
     return (std::toupper(piece.type) == 'P' && move.to.first == promoR);
-}
\ No newline at end of file
+}
+
+// -------------------------------------------------------------
+// Zobristキー
+// -------------------------------------------------------------
+
+// 盤面全体からキーを計算し直す (盤面を直接設定した後に使用)
+uint64_t ChessGame::computeHashKey() const
+{
+    uint64_t key = 0;
+    for (int r = 0; r < 8; r++)
+        for (int c = 0; c < 8; c++)
+            key ^= pieceKey(board[r][c], r, c);
+    return key ^ stateKey(castlingRights, enPassantSquare_);
+}
+
+uint64_t ChessGame::positionKey(bool turnWhite) const
+{
+    return turnWhite ? hashKey_ ^ ZOBRIST.sideToMove : hashKey_;
+}
+
+// -------------------------------------------------------------
+// 置換表の操作
+// -------------------------------------------------------------
+
+bool ChessGame::setHashSize(size_t megabytes)
+{
+    return tt_->resize(megabytes);
+}
+
+void ChessGame::clearHash()
+{
+    tt_->clear();
+}
+
+size_t ChessGame::hashSizeMB() const
+{
+    return tt_->sizeMB();
+}
+
+bool ChessGame::hashUsesHugePages() const
+{
+    return tt_->usesHugePages();
+}
+
+bool ChessGame::hashMove(bool white, Move &move) const
+{
+    std::vector<Move> legal;
+    return hashMove(white, move, legal);
+}
+
+// legal は合法手の生成に使う領域 (探索中は ply ごとのバッファを渡して確保を避ける)
+bool ChessGame::hashMove(bool white, Move &move, std::vector<Move> &legal) const
+{
+    TranspositionTable::Data data;
+    if (!tt_->probe(positionKey(white), data) || data.move == 0)
+    {
+        return false;
+    }
+
+    // ハッシュの衝突で別の局面の手を引いている可能性があるので、合法手と照合する
+    generateMoves(white, false, legal);
+    for (const Move &m : legal)
+    {
+        if (TranspositionTable::packMove(m) == data.move)
+        {
+            move = m;
+            return true;
+        }
+    }
+    return false;
+}
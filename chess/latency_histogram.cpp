@@ -0,0 +1,169 @@
+#include "latency_histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+// ----------------------------------------------------------------------
+// LatencyHistogram
+// ----------------------------------------------------------------------
+// 値 v のバケット: v < 64 はそのまま、それ以上は最上位ビットの位置 e と、
+// その下の 5 ビット (2^e から 2^(e+1) を 32 等分した位置) で決める
+int LatencyHistogram::bucketIndex(uint64_t us)
+{
+    if (us < 2 * SUB_BUCKETS)
+        return static_cast<int>(us);
+
+    int exponent = 63 - __builtin_clzll(us);
+    if (exponent >= MAX_EXPONENT)
+        return BUCKET_COUNT - 1;
+    int sub = static_cast<int>((us >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return 2 * SUB_BUCKETS + (exponent - SUB_BUCKET_BITS - 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < 2 * SUB_BUCKETS)
+        return static_cast<uint64_t>(index);
+
+    int exponent = (index - 2 * SUB_BUCKETS) / SUB_BUCKETS + SUB_BUCKET_BITS + 1;
+    int sub = (index - 2 * SUB_BUCKETS) % SUB_BUCKETS;
+    uint64_t width = 1ULL << (exponent - SUB_BUCKET_BITS);
+    return (1ULL << exponent) + (static_cast<uint64_t>(sub) + 1) * width - 1;
+}
+
+void LatencyHistogram::record(int64_t us)
+{
+    if (us < 0)
+        us = 0;
+    counts_[bucketIndex(static_cast<uint64_t>(us))]++;
+    min_ = count_ ? std::min(min_, us) : us;
+    max_ = std::max(max_, us);
+    sum_ += static_cast<uint64_t>(us);
+    count_++;
+}
+
+void LatencyHistogram::reset()
+{
+    *this = LatencyHistogram();
+}
+
+int64_t LatencyHistogram::percentile(double percent) const
+{
+    if (count_ == 0)
+        return 0;
+
+    // percent% 以上の記録が含まれる最初のバケット
+    uint64_t target = static_cast<uint64_t>(std::ceil(count_ * std::min(100.0, std::max(0.0, percent)) / 100.0));
+    target = std::max<uint64_t>(1, target);
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i)
+    {
+        seen += counts_[i];
+        if (seen >= target)
+            return std::min(static_cast<int64_t>(bucketUpperBound(i)), max_);
+    }
+    return max_;
+}
+
+LatencyHistogram &LatencyHistogram::operator+=(const LatencyHistogram &other)
+{
+    if (other.count_ == 0)
+        return *this;
+    for (int i = 0; i < BUCKET_COUNT; ++i)
+        counts_[i] += other.counts_[i];
+    min_ = count_ ? std::min(min_, other.min_) : other.min_;
+    max_ = std::max(max_, other.max_);
+    sum_ += other.sum_;
+    count_ += other.count_;
+    return *this;
+}
+
+// ----------------------------------------------------------------------
+// 局面の段階
+// ----------------------------------------------------------------------
+const char *gamePhaseName(GamePhase phase)
+{
+    static const char *const NAMES[PHASE_COUNT] = {"opening", "middlegame", "endgame"};
+    return NAMES[phase];
+}
+
+// ----------------------------------------------------------------------
+// MoveLatencyStats
+// ----------------------------------------------------------------------
+void MoveLatencyStats::record(GamePhase phase, int64_t us, const std::string &fen)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    histograms_[phase].record(us);
+    if (histograms_[phase].count() == 1 || us > slowestUs_[phase])
+    {
+        slowestUs_[phase] = us;
+        slowestFen_[phase] = fen;
+    }
+}
+
+void MoveLatencyStats::reset()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int p = 0; p < PHASE_COUNT; ++p)
+    {
+        histograms_[p].reset();
+        slowestUs_[p] = 0;
+        slowestFen_[p].clear();
+    }
+}
+
+LatencyHistogram MoveLatencyStats::histogram(GamePhase phase) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return histograms_[phase];
+}
+
+LatencyHistogram MoveLatencyStats::total() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    LatencyHistogram sum;
+    for (const auto &h : histograms_)
+        sum += h;
+    return sum;
+}
+
+std::string MoveLatencyStats::slowestPosition(GamePhase phase, int64_t &us) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    us = slowestUs_[phase];
+    return slowestFen_[phase];
+}
+
+std::string MoveLatencyStats::report() const
+{
+    std::ostringstream os;
+    auto row = [&os](const char *name, const LatencyHistogram &h)
+    {
+        os << std::left << std::setw(12) << name << std::right
+           << std::setw(8) << h.count()
+           << std::setw(12) << h.percentile(50) / 1000.0
+           << std::setw(12) << h.percentile(90) / 1000.0
+           << std::setw(12) << h.percentile(99) / 1000.0
+           << std::setw(12) << h.max() / 1000.0 << "\n";
+    };
+
+    os << std::fixed << std::setprecision(1)
+       << std::left << std::setw(12) << "phase" << std::right << std::setw(8) << "count"
+       << std::setw(12) << "p50 (ms)" << std::setw(12) << "p90 (ms)" << std::setw(12) << "p99 (ms)"
+       << std::setw(12) << "max (ms)" << "\n";
+    for (int p = 0; p < PHASE_COUNT; ++p)
+        row(gamePhaseName(static_cast<GamePhase>(p)), histogram(static_cast<GamePhase>(p)));
+    row("all", total());
+
+    for (int p = 0; p < PHASE_COUNT; ++p)
+    {
+        int64_t us = 0;
+        std::string fen = slowestPosition(static_cast<GamePhase>(p), us);
+        if (!fen.empty())
+            os << "slowest " << gamePhaseName(static_cast<GamePhase>(p)) << ": " << us / 1000.0 << " ms  " << fen
+               << "\n";
+    }
+    return os.str();
+}
@@ -1,12 +1,93 @@
 #include "chess_game.hpp"
+#include "bench.hpp"
 
+#include <climits>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// 使い方:
+//   chess [持ち時間(秒) [1手ごとの加算(秒) [規定手数]]]   対局 (持ち時間が無ければ固定の深さで指す)
+//   chess bench [depth] [threads] [hashMB] [--json] [--trace file] [--perf] [--treelog file]
+//                                                         ベンチマーク (--json で局面ごとの探索統計、
+//                                                         --trace で Chrome 形式のトレースを書き出す、
+//                                                         --perf でフェーズごとのハードウェアカウンタ、
+//                                                         --treelog で探索木のログ (chess_treelog で集計))
+namespace {
+    const char *const BENCH_USAGE =
+        "usage: chess bench [depth] [threads] [hashMB] [--json] [--trace file] [--perf] [--treelog file]\n";
+
+    // 1 以上の int の範囲の整数だけを受け付ける (末尾に余計な文字があれば不正)
+    bool parsePositive(const std::string &text, long &value) {
+        char *end = nullptr;
+        value = std::strtol(text.c_str(), &end, 10);
+        return !text.empty() && *end == '\0' && value > 0 && value <= INT_MAX;
+    }
+
+    int benchUsageError(const std::string &message) {
+        std::cerr << "chess bench: " << message << "\n" << BENCH_USAGE;
+        return 1;
+    }
+
+    // 探索できる範囲を超える depth/threads を受け付けない
+    int benchRangeError(const char *name, long value, int max) {
+        return benchUsageError(std::string(name) + " " + std::to_string(value) + " is out of range (1-" +
+                               std::to_string(max) + ")");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "bench") {
+        // 数値の引数は順に depth, threads, hashMB。--json/--trace/--perf/--treelog はどこに置いてもよい
+        bool json = false;
+        bool perf = false;
+        std::string tracePath;
+        std::string treeLogPath;
+        std::vector<long> values;
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            long value = 0;
+            if (arg == "--json")
+                json = true;
+            else if (arg == "--perf")
+                perf = true;
+            else if (arg == "--trace" || arg == "--treelog") {
+                if (i + 1 >= argc)
+                    return benchUsageError(arg + " requires a file name");
+                (arg == "--trace" ? tracePath : treeLogPath) = argv[++i];
+            }
+            else if (arg.size() > 1 && arg[0] == '-')
+                return benchUsageError("unknown option '" + arg + "'");
+            else if (!parsePositive(arg, value))
+                return benchUsageError("'" + arg + "' is not a positive integer");
+            else if (values.size() == 3)
+                return benchUsageError("too many arguments");
+            else
+                values.push_back(value);
+        }
+        if (values.size() > 0 && values[0] > MAX_SEARCH_DEPTH)
+            return benchRangeError("depth", values[0], MAX_SEARCH_DEPTH);
+        if (values.size() > 1 && values[1] > MAX_SEARCH_THREADS)
+            return benchRangeError("threads", values[1], MAX_SEARCH_THREADS);
+        int depth = values.size() > 0 ? static_cast<int>(values[0]) : BENCH_DEFAULT_DEPTH;
+        int threads = values.size() > 1 ? static_cast<int>(values[1]) : 1;
+        long hashMB = values.size() > 2 ? values[2] : static_cast<long>(TranspositionTable::DEFAULT_SIZE_MB);
+        return runBench(depth, threads, static_cast<size_t>(hashMB), json, tracePath, perf, treeLogPath);
+    }
 
-int main() {
     // ChessGame クラスのインスタンスを作成
     ChessGame game;
-    
+
+    if (argc > 1) {
+        double baseSeconds = std::atof(argv[1]);
+        double incrementSeconds = argc > 2 ? std::atof(argv[2]) : 0.0;
+        int movesPerControl = argc > 3 ? std::atoi(argv[3]) : 0;
+        game.setTimeControl(static_cast<int64_t>(baseSeconds * 1000),
+                            static_cast<int64_t>(incrementSeconds * 1000), movesPerControl);
+    }
+
     // ゲームの実行ロジックを呼び出す
     game.runGame();
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,251 @@
+// -------------------------------------------------------------
+// マイクロベンチマーク (chess_bench [iterations])
+// bench の局面集に対して、探索の内部関数を1つずつ繰り返し呼び出し、1回あたりの時間を表示する。
+// NPS 全体では分からない速度の変化を、どの関数によるものか切り分けるためのもの
+// FEN は呼び出し側が使う getBoardStateFEN (毎回文字列を返す) と、探索の繰り返し判定が使う
+// writeBoardStateFEN (出力先を使い回す) の両方を測る
+// CHESS_ALLOC_COUNTING=ON のビルドでは、これらの関数と探索ノード (negamax/quiescence) が
+// ヒープを1回も確保しないことも確認し、確保していれば終了コード 1 で失敗する (ctest の search_allocations)
+// -------------------------------------------------------------
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "alloc_counter.hpp"
+#include "bench.hpp"
+#include "chess_game.hpp"
+
+// ChessGame の private 関数への窓口 (chess_game.hpp で friend 宣言されている)
+struct ChessGameBenchAccess
+{
+    static void generateMoves(const ChessGame &game, bool white, std::vector<Move> &moves)
+    {
+        game.generateMoves(white, false, moves);
+    }
+    static void makeMove(ChessGame &game, Move &m) { game.makeMoveInternal(m); }
+    static void unmakeMove(ChessGame &game, const Move &m) { game.unmakeMoveInternal(m); }
+    static bool isSquareAttacked(const ChessGame &game, int r, int c, bool attackingWhite)
+    {
+        return game.isSquareAttacked(r, c, attackingWhite);
+    }
+    static int evaluate(const ChessGame &game) { return game.evaluate(); }
+};
+
+namespace
+{
+    constexpr int DEFAULT_ITERATIONS = 2000;
+    constexpr int SEARCH_CHECK_DEPTH = 5;
+
+    // 全局面で共有する置換表 (MB)。計測する関数は置換表を使わないので小さくてよい
+    constexpr size_t HASH_MB = 1;
+
+    struct BenchPosition
+    {
+        explicit BenchPosition(const ChessGame &base) : game(base) {}
+
+        ChessGame game;
+        bool white = true;
+        std::vector<Move> moves;  // 合法手 (make/unmake の計測用)
+        std::vector<Move> buffer; // generateMoves の出力先 (使い回す)
+        std::string fen;          // writeBoardStateFEN の出力先 (使い回す)
+    };
+
+    bool allocationFree = true;
+
+    // 計測結果を最適化で消されないように、戻り値をここへ畳み込む
+    volatile uint64_t sink = 0;
+
+    // pass() を iterations 回実行し、1呼び出しあたりの時間 (と確保回数) を表示する
+    // pass() は1回の実行で呼び出した回数を返す。hotPath なら、ウォームアップ後は1回も確保してはいけない
+    // (hotPath = false は探索では使わない関数で、確保の回数を表示するだけ)
+    template <typename Pass>
+    void measure(const char *name, int iterations, Pass pass, bool hotPath = true)
+    {
+        pass(); // ウォームアップ (出力先のバッファの確保もここで済ませる)
+
+        uint64_t calls = 0;
+        AllocStats allocsBefore = AllocCounter::snapshot();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            calls += pass();
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+        AllocStats allocs = AllocCounter::snapshot() - allocsBefore;
+
+        std::cout << std::left << std::setw(28) << name << std::right
+                  << std::setw(12) << calls
+                  << std::setw(14) << std::fixed << std::setprecision(1)
+                  << (calls ? static_cast<double>(ns) / calls : 0.0);
+        if (ALLOC_COUNTING_ENABLED)
+        {
+            std::cout << std::setw(14) << allocs.allocations;
+            if (hotPath && allocs.allocations > 0)
+            {
+                std::cout << "  FAILED: allocates on the hot path";
+                allocationFree = false;
+            }
+        }
+        std::cout << "\n";
+    }
+
+    // 探索ノードの中では1回も確保しないこと
+    // (ルートでの結果や読み筋の組み立ては探索ごと/反復ごとの確保なので、件数を表示するだけ)
+    void checkSearchAllocations(std::vector<BenchPosition> &positions)
+    {
+        SearchOptions options;
+        options.deterministic = true;
+        SearchLimits limits;
+        limits.depth = SEARCH_CHECK_DEPTH;
+
+        uint64_t nodes = 0;
+        uint64_t nodeAllocs = 0;
+        AllocStats allocs;
+        for (BenchPosition &p : positions)
+        {
+            ChessGame game = p.game;
+            game.setSearchOptions(options);
+            game.search(p.white, limits); // ウォームアップ (ply ごとのバッファの確保を済ませる)
+
+            AllocStats before = AllocCounter::snapshot();
+            uint64_t nodeBefore = AllocCounter::nodeAllocations();
+            nodes += game.search(p.white, limits).nodes;
+            nodeAllocs += AllocCounter::nodeAllocations() - nodeBefore;
+            AllocStats after = AllocCounter::snapshot() - before;
+            allocs.allocations += after.allocations;
+            allocs.bytes += after.bytes;
+        }
+
+        std::cout << "\nSearch (depth " << SEARCH_CHECK_DEPTH << "): " << nodes << " nodes, "
+                  << nodeAllocs << " allocations in nodes, " << allocs.allocations << " at the root ("
+                  << std::setprecision(4) << static_cast<double>(allocs.allocations) / (nodes ? nodes : 1)
+                  << " per node)";
+        if (nodeAllocs > 0)
+        {
+            std::cout << "  FAILED: allocates inside search nodes";
+            allocationFree = false;
+        }
+        std::cout << "\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = argc > 1 ? std::atoi(argv[1]) : DEFAULT_ITERATIONS;
+    if (iterations <= 0)
+        iterations = DEFAULT_ITERATIONS;
+
+    // 各局面の ChessGame は base のコピーなので、置換表を共有する
+    ChessGame base;
+    base.setHashSize(HASH_MB);
+    std::vector<BenchPosition> positions;
+    positions.reserve(benchPositions().size());
+    for (size_t i = 0; i < benchPositions().size(); ++i)
+    {
+        positions.emplace_back(base);
+        BenchPosition &p = positions.back();
+        if (!p.game.initBoardWithFEN(benchPositions()[i], p.white))
+        {
+            std::cerr << "Invalid bench position: " << benchPositions()[i] << "\n";
+            return 1;
+        }
+        p.moves = p.game.generateMoves(p.white);
+    }
+
+    std::cout << "Positions  : " << positions.size() << "\n"
+              << "Iterations : " << iterations << "\n\n"
+              << std::left << std::setw(28) << "Function" << std::right
+              << std::setw(12) << "calls" << std::setw(14) << "ns/call"
+              << (ALLOC_COUNTING_ENABLED ? "        allocs" : "") << "\n";
+
+    measure("generateMoves", iterations, [&]()
+            {
+                uint64_t calls = 0;
+                for (BenchPosition &p : positions)
+                {
+                    ChessGameBenchAccess::generateMoves(p.game, p.white, p.buffer);
+                    sink = sink + p.buffer.size();
+                    calls++;
+                }
+                return calls; });
+
+    // 合法手を1手ずつ指して戻す (1ペアを1回と数える)
+    measure("makeMove/unmakeMove", iterations, [&]()
+            {
+                uint64_t calls = 0;
+                for (BenchPosition &p : positions)
+                    for (const Move &move : p.moves)
+                    {
+                        Move m = move;
+                        ChessGameBenchAccess::makeMove(p.game, m);
+                        ChessGameBenchAccess::unmakeMove(p.game, m);
+                        calls++;
+                    }
+                sink = sink + calls;
+                return calls; });
+
+    // 全マス x 両方の色
+    measure("isSquareAttacked", iterations, [&]()
+            {
+                uint64_t calls = 0, attacked = 0;
+                for (const BenchPosition &p : positions)
+                    for (int r = 0; r < 8; ++r)
+                        for (int c = 0; c < 8; ++c)
+                        {
+                            attacked += ChessGameBenchAccess::isSquareAttacked(p.game, r, c, true);
+                            attacked += ChessGameBenchAccess::isSquareAttacked(p.game, r, c, false);
+                            calls += 2;
+                        }
+                sink = sink + attacked;
+                return calls; });
+
+    measure("evaluate", iterations, [&]()
+            {
+                uint64_t calls = 0;
+                for (const BenchPosition &p : positions)
+                {
+                    sink = sink + static_cast<uint64_t>(ChessGameBenchAccess::evaluate(p.game));
+                    calls++;
+                }
+                return calls; });
+
+    // 戻り値の文字列を毎回確保する
+    measure("getBoardStateFEN", iterations, [&]()
+            {
+                uint64_t calls = 0;
+                for (const BenchPosition &p : positions)
+                {
+                    sink = sink + p.game.getBoardStateFEN(p.white).size();
+                    calls++;
+                }
+                return calls; },
+            false);
+
+    measure("writeBoardStateFEN", iterations, [&]()
+            {
+                uint64_t calls = 0;
+                for (BenchPosition &p : positions)
+                {
+                    p.game.writeBoardStateFEN(p.white, p.fen);
+                    sink = sink + p.fen.size();
+                    calls++;
+                }
+                return calls; });
+
+    if (!ALLOC_COUNTING_ENABLED)
+        return 0;
+
+    checkSearchAllocations(positions);
+    if (!allocationFree)
+    {
+        std::cout << "Allocation check FAILED\n";
+        return 1;
+    }
+    std::cout << "Allocation check passed\n";
+    return 0;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// -------------------------------------------------------------
+// ハードウェア性能カウンタ (Linux の perf_event_open, 解析用)
+// ・サイクル数/命令数/キャッシュミス/分岐予測ミスを、探索のフェーズ (合法手生成/評価/置換表の参照)
+//   ごとに集計する。フェーズの出入りでカウンタを読むので、計測中は探索が遅くなる
+//   (カーネル内の時間は数えないので、読み出しのシステムコール自体はほぼ値に入らない)
+// ・CMake の CHESS_PERF_COUNTERS=ON でビルドしたときだけ計測コードが入る。
+//   無効なビルドでは PerfScope は空になり、コストは無い
+// ・カウンタは start() を呼んだスレッドだけを数える (ヘルパースレッドは対象外)
+// -------------------------------------------------------------
+#if !defined(__linux__)
+#undef CHESS_PERF_COUNTERS
+#define CHESS_PERF_COUNTERS 0
+#elif !defined(CHESS_PERF_COUNTERS)
+#define CHESS_PERF_COUNTERS 0
+#endif
+constexpr bool PERF_COUNTERS_ENABLED = CHESS_PERF_COUNTERS != 0;
+
+enum PerfPhase
+{
+    PERF_MOVEGEN = 0,
+    PERF_EVAL,
+    PERF_TT_PROBE,
+    PERF_PHASE_COUNT
+};
+
+enum PerfEvent
+{
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_EVENT_COUNT
+};
+
+// 各イベントの値 (開けなかったイベントは 0)
+struct PerfSample
+{
+    uint64_t values[PERF_EVENT_COUNT] = {};
+
+    PerfSample &operator+=(const PerfSample &other)
+    {
+        for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+            values[i] += other.values[i];
+        return *this;
+    }
+};
+
+class PerfCounters
+{
+public:
+    /**
+     * @brief 呼び出したスレッドのカウンタを開き、集計を 0 から始める
+     * @param error 失敗時の理由 (カーネルが許可しない、PMU が無いなど)
+     * @return 1つ以上のイベントを開けたら true
+     */
+    static bool start(std::string &error);
+
+    // カウンタを閉じる (集計値は次の start() まで読める)
+    static void stop();
+
+    // このスレッドで計測中か
+    static bool active();
+
+    // イベントを開けたか (PMU によっては一部のイベントが無い)
+    static bool available(PerfEvent event);
+
+    // start() からの合計と、フェーズごとの合計
+    static PerfSample total();
+    static PerfSample phase(PerfPhase phase);
+
+    static const char *eventName(PerfEvent event);
+    static const char *phaseName(PerfPhase phase);
+
+    // PerfScope が使う (入れ子になったフェーズは外側にまとめて数える)
+    static void enter(PerfPhase phase);
+    static void leave();
+};
+
+// フェーズの区間 (関数の先頭に置く)
+class PerfScope
+{
+public:
+    explicit PerfScope(PerfPhase phase)
+    {
+        if constexpr (PERF_COUNTERS_ENABLED)
+            PerfCounters::enter(phase);
+    }
+
+    ~PerfScope()
+    {
+        if constexpr (PERF_COUNTERS_ENABLED)
+            PerfCounters::leave();
+    }
+
+    PerfScope(const PerfScope &) = delete;
+    PerfScope &operator=(const PerfScope &) = delete;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// -------------------------------------------------------------
+// 探索のトレース (解析用, 既定では無効)
+// ・反復の開始/終了、ルートの最善手の変化、置換表の確保、時間管理の判断、スレッドの開始/終了を
+//   時刻つきのイベントとして記録し、Chrome の trace_event 形式の JSON に書き出す
+//   (chrome://tracing や Perfetto で開くと、スレッドごとのタイムラインになる)
+// ・イベントはスレッドごとのリングバッファに書くのでロックを取らない。
+//   容量を超えると古いイベントから上書きされる
+// ・イベント名と引数名は文字列リテラルを渡すこと (ポインタだけを保存する)
+// ・clear() と書き出しは探索中でないときに呼ぶ
+// -------------------------------------------------------------
+// イベントの整数の引数 (name が nullptr なら無し)
+struct TraceArg
+{
+    const char *name = nullptr;
+    int64_t value = 0;
+};
+
+class SearchTrace
+{
+public:
+    static constexpr size_t EVENTS_PER_THREAD = 1 << 14;
+
+    static void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // 記録済みのイベントを全て消す
+    static void clear();
+
+    // 呼び出したスレッドのタイムラインに表示する名前
+    static void setThreadName(const std::string &name);
+
+    // 区間の開始/終了 (同じスレッドで対にする) と、時点のイベント
+    // move は手の表記 (15文字まで)
+    static void begin(const char *name, TraceArg a = {}, TraceArg b = {}, TraceArg c = {});
+    static void end(const char *name, TraceArg a = {}, TraceArg b = {}, TraceArg c = {});
+    static void instant(const char *name, TraceArg a = {}, TraceArg b = {}, TraceArg c = {}, const char *move = nullptr);
+
+    // trace_event 形式の JSON
+    static std::string chromeJson();
+    static bool writeChromeJson(const std::string &path); // 失敗時は false
+
+private:
+    static std::atomic<bool> enabled_;
+
+    static void record(char phase, const char *name, TraceArg a, TraceArg b, TraceArg c, const char *text);
+};
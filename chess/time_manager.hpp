@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+
+#include "search_types.hpp"
+
+// -------------------------------------------------------------
+// 時間管理 (対局時計で指すとき、1手に使う時間を決める)
+// ・ソフトリミット: 反復が終わるたびに確認し、超えていたら次の反復を始めない。
+//   最善手が変わり続ける (不安定) / 評価値が下がった (fail-low) ときは延ばし、
+//   最善手が安定してノードの大半を占めている (1手が支配的) ときは縮める
+// ・ハードリミット: 反復の途中でも探索を打ち切る上限 (持ち時間切れを防ぐ)
+// -------------------------------------------------------------
+class TimeManager
+{
+public:
+    /**
+     * @brief 探索開始時に、持ち時間から1手の時間を割り当てる
+     * @param limits remainingMs/incrementMs/movesToGo を使う
+     * @param legalMoves ルートの合法手の数 (1手しか無ければすぐに指す)
+     */
+    void init(const SearchLimits &limits, size_t legalMoves);
+
+    // 持ち時間が指定されていて、時間管理が有効か
+    bool active() const { return active_; }
+
+    int64_t softLimitMs() const { return softMs_; }
+    int64_t hardLimitMs() const { return hardMs_; }
+
+    /**
+     * @brief 反復が完了するたびに呼ぶ
+     * @param elapsedMs 探索開始 (ponder hit) からの経過時間
+     * @param bestMove この反復の最善手 (packMove 形式)
+     * @param score この反復の評価値 (手番側視点)
+     * @param failedLow この反復のルートでアスピレーションウィンドウが fail-low したか
+     * @param bestMoveEffort この反復のノードのうち最善手に使った割合 (0.0 - 1.0)
+     * @return 次の反復を始めずに止めるなら true
+     */
+    bool iterationDone(int64_t elapsedMs, uint16_t bestMove, int score, bool failedLow, double bestMoveEffort);
+
+    // 直近の判断で使った、ソフトリミットに掛ける倍率
+    double scale() const { return scale_; }
+
+private:
+    bool active_ = false;
+    bool singleMove_ = false;
+    int64_t softMs_ = 0;
+    int64_t hardMs_ = 0;
+
+    int iterations_ = 0;
+    uint16_t lastBestMove_ = 0;
+    int lastScore_ = 0;
+    int stableIterations_ = 0; // 最善手が変わらなかった連続回数
+    double instability_ = 0.0; // 最善手の変化 (反復ごとに半減する)
+    double scale_ = 1.0;
+};
@@ -0,0 +1,283 @@
+#include "transposition_table.hpp"
+#include "perf_counters.hpp"
+#include "search_trace.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+    constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    uint64_t packData(uint16_t move, int score, int depth, TranspositionTable::Bound bound, uint8_t generation)
+    {
+        return static_cast<uint64_t>(move) |
+               (static_cast<uint64_t>(static_cast<uint32_t>(score)) << 16) |
+               (static_cast<uint64_t>(static_cast<uint8_t>(depth)) << 48) |
+               (static_cast<uint64_t>(bound & 0x3) << 56) |
+               (static_cast<uint64_t>(generation & 0x3F) << 58);
+    }
+
+    int dataDepth(uint64_t data) { return static_cast<int8_t>((data >> 48) & 0xFF); }
+    uint8_t dataGeneration(uint64_t data) { return static_cast<uint8_t>(data >> 58); }
+
+#ifdef __linux__
+    // /proc/self/smaps から、ptr を含むマッピングの AnonHugePages (kB) を読む
+    bool mappingHasHugePages(const void *ptr)
+    {
+        std::ifstream smaps("/proc/self/smaps");
+        if (!smaps)
+            return false;
+
+        uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+        bool inTarget = false;
+        std::string line;
+        while (std::getline(smaps, line))
+        {
+            // マッピングのヘッダ行: "start-end perms offset dev inode path"
+            size_t dash = line.find('-');
+            size_t space = line.find(' ');
+            if (dash != std::string::npos && space != std::string::npos && dash < space &&
+                line.find(':') > space)
+            {
+                uintptr_t start = std::stoull(line.substr(0, dash), nullptr, 16);
+                uintptr_t end = std::stoull(line.substr(dash + 1, space - dash - 1), nullptr, 16);
+                inTarget = (start <= addr && addr < end);
+                continue;
+            }
+            if (inTarget && line.rfind("AnonHugePages:", 0) == 0)
+            {
+                std::istringstream iss(line.substr(14));
+                long kb = 0;
+                iss >> kb;
+                return kb > 0;
+            }
+        }
+        return false;
+    }
+#endif
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes)
+{
+    // 確保できなければ半分のサイズで確保し直す (1MB も確保できなければ std::bad_alloc)
+    if (megabytes == 0)
+        megabytes = 1;
+    while (!resize(megabytes))
+    {
+        if (megabytes == 1)
+            throw std::bad_alloc();
+        megabytes /= 2;
+    }
+}
+
+TranspositionTable::~TranspositionTable()
+{
+    release();
+}
+
+bool TranspositionTable::resize(size_t megabytes)
+{
+    if (megabytes == 0)
+        megabytes = 1;
+
+    if (table_ && megabytes == sizeMB_)
+    {
+        clear();
+        return true;
+    }
+
+    // 確保とゼロクリアはサイズによっては時間がかかるので、トレースに区間として残す
+    SearchTrace::begin("tt resize", {"mb", static_cast<int64_t>(megabytes)});
+
+    // 新しい領域を先に確保し、失敗したら古いテーブルを残す
+    Cluster *oldTable = table_;
+    size_t oldCount = clusterCount_, oldMB = sizeMB_, oldBytes = allocatedBytes_;
+    bool oldHuge = hugePages_;
+    table_ = nullptr;
+
+    if (!allocate(megabytes))
+    {
+        table_ = oldTable;
+        clusterCount_ = oldCount;
+        sizeMB_ = oldMB;
+        allocatedBytes_ = oldBytes;
+        hugePages_ = oldHuge;
+        SearchTrace::end("tt resize", {"ok", 0});
+        return false;
+    }
+
+    std::free(oldTable);
+    SearchTrace::end("tt resize", {"ok", 1}, {"hugePages", hugePages_ ? 1 : 0});
+    return true;
+}
+
+bool TranspositionTable::allocate(size_t megabytes)
+{
+    size_t bytes = megabytes * 1024 * 1024;
+    hugePages_ = false;
+
+#ifdef __linux__
+    // 2MB境界・2MBの倍数で確保し、透過的ヒュージページ (THP) を要求する
+    size_t hugeBytes = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    void *mem = std::aligned_alloc(HUGE_PAGE_SIZE, hugeBytes);
+    bool advised = false;
+    if (mem)
+    {
+        advised = madvise(mem, hugeBytes, MADV_HUGEPAGE) == 0;
+        bytes = hugeBytes;
+    }
+    else
+    {
+        // フォールバック: 通常ページ
+        mem = std::aligned_alloc(alignof(Cluster), bytes);
+    }
+#else
+    void *mem = std::aligned_alloc(alignof(Cluster), bytes);
+#endif
+
+    if (!mem)
+        return false;
+
+    table_ = static_cast<Cluster *>(mem);
+    allocatedBytes_ = bytes;
+    clusterCount_ = bytes / sizeof(Cluster);
+    sizeMB_ = megabytes;
+    generation_ = 0;
+
+    // エントリ (atomic) を値初期化 (= 0) で構築する。ページが実際に割り当てられてから、
+    // ヒュージページになったか確認する
+    for (size_t i = 0; i < clusterCount_; ++i)
+        new (&table_[i]) Cluster();
+#ifdef __linux__
+    hugePages_ = advised && mappingHasHugePages(table_);
+#endif
+    return true;
+}
+
+void TranspositionTable::release()
+{
+    std::free(table_);
+    table_ = nullptr;
+    clusterCount_ = 0;
+    allocatedBytes_ = 0;
+    hugePages_ = false;
+}
+
+void TranspositionTable::clear()
+{
+    // atomic は memset せず、1つずつ 0 を書き込む
+    for (size_t i = 0; i < clusterCount_; ++i)
+        for (Entry &e : table_[i].entries)
+        {
+            e.keyXorData.store(0, std::memory_order_relaxed);
+            e.data.store(0, std::memory_order_relaxed);
+        }
+    generation_ = 0;
+}
+
+void TranspositionTable::newSearch()
+{
+    generation_ = (generation_ + 1) & 0x3F;
+}
+
+bool TranspositionTable::probe(uint64_t key, Data &out) const
+{
+    PerfScope perf(PERF_TT_PROBE);
+    const Cluster &cluster = clusterFor(key);
+    for (const Entry &e : cluster.entries)
+    {
+        uint64_t data = e.data.load(std::memory_order_relaxed);
+        uint64_t keyXorData = e.keyXorData.load(std::memory_order_relaxed);
+        if (data != 0 && (keyXorData ^ data) == key)
+        {
+            out.move = static_cast<uint16_t>(data & 0xFFFF);
+            out.score = static_cast<int32_t>(static_cast<uint32_t>(data >> 16));
+            out.depth = dataDepth(data);
+            out.bound = static_cast<Bound>((data >> 56) & 0x3);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, int score, Bound bound, uint16_t move)
+{
+    Cluster &cluster = clusterFor(key);
+
+    // 置換対象の選択: 同一キー > 空き > (古い世代 かつ 浅い) エントリ
+    Entry *replace = &cluster.entries[0];
+    int replaceValue = 1 << 30;
+    for (Entry &e : cluster.entries)
+    {
+        uint64_t data = e.data.load(std::memory_order_relaxed);
+        bool sameKey = (e.keyXorData.load(std::memory_order_relaxed) ^ data) == key;
+        if (sameKey || data == 0)
+        {
+            // 同一局面で最善手が無い場合は、以前の最善手を残す
+            if (sameKey && move == 0)
+                move = static_cast<uint16_t>(data & 0xFFFF);
+            replace = &e;
+            break;
+        }
+        int age = (generation_ - dataGeneration(data)) & 0x3F;
+        int value = dataDepth(data) - 8 * age;
+        if (value < replaceValue)
+        {
+            replaceValue = value;
+            replace = &e;
+        }
+    }
+
+    uint64_t data = packData(move, score, depth, bound, generation_);
+    replace->data.store(data, std::memory_order_relaxed);
+    replace->keyXorData.store(key ^ data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const
+{
+    size_t samples = clusterCount_ < 1000 ? clusterCount_ : 1000;
+    if (samples == 0)
+        return 0;
+
+    size_t used = 0;
+    for (size_t i = 0; i < samples; ++i)
+        for (const Entry &e : table_[i].entries)
+        {
+            uint64_t data = e.data.load(std::memory_order_relaxed);
+            if (data != 0 && dataGeneration(data) == generation_)
+                used++;
+        }
+    return static_cast<int>(used * 1000 / (samples * CLUSTER_SIZE));
+}
+
+uint16_t TranspositionTable::packMove(const Move &m)
+{
+    int from = m.from.first * 8 + m.from.second;
+    int to = m.to.first * 8 + m.to.second;
+    int promo = 0;
+    switch (std::toupper(m.promotedTo))
+    {
+    case 'N':
+        promo = 1;
+        break;
+    case 'B':
+        promo = 2;
+        break;
+    case 'R':
+        promo = 3;
+        break;
+    case 'Q':
+        promo = 4;
+        break;
+    }
+    return static_cast<uint16_t>(from | (to << 6) | (promo << 12));
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "types.hpp"
+
+// -------------------------------------------------------------
+// 置換表 (Transposition Table)
+// ・Zobristキーで局面を引き、探索結果 (深さ/評価値/境界/最善手) を保存する
+// ・4エントリ = 64バイトのクラスタ単位で確保し、1回のプローブを1キャッシュラインに収める
+// ・Linuxでは 2MB 境界で確保して madvise(MADV_HUGEPAGE) を要求し、TLBミスを減らす
+//   (カーネルが許可しない場合は通常ページのまま動作する)
+// ・Lazy SMP で複数スレッドから同時に読み書きされるため、エントリはロックレス
+//   (key ^ data を保存し、読み出し時に整合性を検証する) で扱う
+// -------------------------------------------------------------
+class TranspositionTable
+{
+public:
+    // 評価値の境界の種類
+    enum Bound : uint8_t
+    {
+        BOUND_NONE = 0,
+        BOUND_UPPER = 1, // fail-low: 真の値は score 以下
+        BOUND_LOWER = 2, // fail-high: 真の値は score 以上
+        BOUND_EXACT = 3
+    };
+
+    // プローブ結果
+    struct Data
+    {
+        uint16_t move = 0; // packMove() 形式 (0 = 手なし)
+        int score = 0;
+        int depth = 0;
+        Bound bound = BOUND_NONE;
+    };
+
+    static constexpr size_t DEFAULT_SIZE_MB = 16;
+
+    // 確保できなければサイズを半分ずつ減らして確保する。1MB も確保できなければ std::bad_alloc を投げる
+    explicit TranspositionTable(size_t megabytes = DEFAULT_SIZE_MB);
+    ~TranspositionTable();
+
+    TranspositionTable(const TranspositionTable &) = delete;
+    TranspositionTable &operator=(const TranspositionTable &) = delete;
+
+    /**
+     * @brief テーブルを指定サイズで確保し直す (内容は消える)
+     * @param megabytes 新しいサイズ (MB)。0 の場合は 1MB として扱う
+     * @return 確保に成功したら true。失敗時は以前のテーブルを保持する
+     */
+    bool resize(size_t megabytes);
+
+    // 全エントリを消去する
+    void clear();
+
+    // 新しい探索の開始 (世代を進め、古いエントリを置換されやすくする)
+    void newSearch();
+
+    bool probe(uint64_t key, Data &out) const;
+    void store(uint64_t key, int depth, int score, Bound bound, uint16_t move);
+
+    size_t sizeMB() const { return sizeMB_; }
+    size_t entryCount() const { return clusterCount_ * CLUSTER_SIZE; }
+
+    // ヒュージページを実際に取得できたか (/proc/self/smaps の AnonHugePages で確認)
+    bool usesHugePages() const { return hugePages_; }
+
+    // 使用率 (千分率)。先頭1000クラスタのサンプルから推定する
+    int hashfull() const;
+
+    // Move <-> 16bit 表現の変換 (from:6bit, to:6bit, promo:3bit)
+    static uint16_t packMove(const Move &m);
+
+private:
+    struct Entry
+    {
+        std::atomic<uint64_t> keyXorData; // 書き込みが競合して壊れたエントリは検出できる
+        std::atomic<uint64_t> data;       // move:16 | score:32 | depth:8 | bound:2 | generation:6
+    };
+
+    static constexpr int CLUSTER_SIZE = 4;
+
+    struct alignas(64) Cluster
+    {
+        Entry entries[CLUSTER_SIZE];
+    };
+
+    Cluster *table_ = nullptr;
+    size_t clusterCount_ = 0;
+    size_t sizeMB_ = 0;
+    size_t allocatedBytes_ = 0;
+    bool hugePages_ = false;
+    uint8_t generation_ = 0;
+
+    bool allocate(size_t megabytes);
+    void release();
+
+    Cluster &clusterFor(uint64_t key) const
+    {
+        // 上位ビットとクラスタ数の積で添字を求める (剰余より高速で偏りが少ない)
+        return table_[(static_cast<unsigned __int128>(key) * clusterCount_) >> 64];
+    }
+};
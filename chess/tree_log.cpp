@@ -0,0 +1,98 @@
+#include "tree_log.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+// ----------------------------------------------------------------------
+// TreeLog
+// ----------------------------------------------------------------------
+TreeLog::~TreeLog()
+{
+    close();
+}
+
+bool TreeLog::open(const std::string &path, std::string &error)
+{
+    close();
+
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_)
+    {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    TreeLogHeader header;
+    if (std::fwrite(&header, sizeof(header), 1, file_) != 1)
+    {
+        error = path + ": failed to write header";
+        std::fclose(file_);
+        file_ = nullptr;
+        return false;
+    }
+
+    if (!buffer_)
+        buffer_.reset(new TreeLogRecord[BUFFER_RECORDS]);
+    buffered_ = 0;
+    records_ = 0;
+    failed_ = false;
+    return true;
+}
+
+bool TreeLog::close()
+{
+    if (!file_)
+        return !failed_;
+
+    flush();
+    if (std::fclose(file_) != 0)
+        failed_ = true;
+    file_ = nullptr;
+    return !failed_;
+}
+
+void TreeLog::flush()
+{
+    if (buffered_ > 0 && std::fwrite(buffer_.get(), sizeof(TreeLogRecord), buffered_, file_) != buffered_)
+        failed_ = true;
+    buffered_ = 0;
+}
+
+// ----------------------------------------------------------------------
+// TreeLogReader
+// ----------------------------------------------------------------------
+TreeLogReader::~TreeLogReader()
+{
+    if (file_)
+        std::fclose(file_);
+}
+
+bool TreeLogReader::open(const std::string &path, std::string &error)
+{
+    if (file_)
+        std::fclose(file_);
+
+    file_ = std::fopen(path.c_str(), "rb");
+    if (!file_)
+    {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    TreeLogHeader header;
+    if (std::fread(&header, sizeof(header), 1, file_) != 1 || header.magic != TreeLogHeader::MAGIC)
+        error = path + ": not a search tree log";
+    else if (header.version != TreeLogHeader::VERSION || header.recordSize != sizeof(TreeLogRecord))
+        error = path + ": unsupported tree log version " + std::to_string(header.version);
+    else
+        return true;
+
+    std::fclose(file_);
+    file_ = nullptr;
+    return false;
+}
+
+bool TreeLogReader::next(TreeLogRecord &record)
+{
+    return file_ && std::fread(&record, sizeof(record), 1, file_) == 1;
+}
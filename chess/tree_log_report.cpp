@@ -0,0 +1,195 @@
+// -------------------------------------------------------------
+// 探索木のログの集計 (chess_treelog <file> [rootDepth])
+// chess bench --treelog で書き出したログを読み、ノードの ply ごとに
+// 置換表/枝刈りでの打ち切り、beta カットを起こした手の位置の分布、LMR/PVS の読み直し率を表示する
+// rootDepth を指定すると、その深さの反復のノードだけを数える
+// -------------------------------------------------------------
+
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "tree_log.hpp"
+
+namespace
+{
+    // カット位置の分布の区切り (0, 1, 2, 3, 4-7, 8 以上)
+    constexpr int CUTOFF_BUCKETS = 6;
+    const char *const CUTOFF_BUCKET_NAMES[CUTOFF_BUCKETS] = {"1st", "2nd", "3rd", "4th", "5-8", "9+"};
+
+    int cutoffBucket(int index)
+    {
+        return index < 4 ? index : index < 8 ? 4 : 5;
+    }
+
+    // ply ごとの集計 (ply は記録されたノード自身の ply)
+    struct PlyStats
+    {
+        uint64_t nodes = 0;      // 読んだノード (フューティリティで読まなかった手は除く)
+        uint64_t ttCutoffs = 0;  // 置換表の値で打ち切った
+        uint64_t nodePrunes = 0; // リバースフューティリティ/ヌルムーブで打ち切った
+        uint64_t expanded = 0;   // 手を生成して読んだ (残り深さ 1 以上で、打ち切られなかった)
+        uint64_t cutoffs = 0;
+        uint64_t cutoffIndexSum = 0;
+        uint64_t cutoffBuckets[CUTOFF_BUCKETS] = {};
+
+        uint64_t futilityPrunes = 0;
+        uint64_t reduced = 0;
+        uint64_t lmrResearches = 0;
+        uint64_t scouts = 0; // 2手目以降のヌルウィンドウ探索 (読み直しを除く)
+        uint64_t pvsResearches = 0;
+        uint64_t aspirationResearches = 0;
+        uint64_t nullMoves = 0;
+        uint64_t nullMoveCutoffs = 0;
+
+        void add(const TreeLogRecord &r)
+        {
+            if (r.flags & TREE_PRUNED)
+            {
+                futilityPrunes++;
+                return;
+            }
+
+            nodes++;
+            if (r.flags & TREE_TT_CUTOFF)
+                ttCutoffs++;
+            else if (r.flags & TREE_NODE_PRUNED)
+                nodePrunes++;
+            else if (r.depth > 0)
+                expanded++;
+
+            if (r.cutoffIndex >= 0)
+            {
+                cutoffs++;
+                cutoffIndexSum += static_cast<uint64_t>(r.cutoffIndex);
+                cutoffBuckets[cutoffBucket(r.cutoffIndex)]++;
+            }
+
+            if (r.flags & TREE_NULL_MOVE)
+            {
+                nullMoves++;
+                // 子ノードが alpha 以下 (親から見て beta 以上) ならヌルムーブで打ち切れた
+                if (r.score <= r.alpha)
+                    nullMoveCutoffs++;
+                return;
+            }
+            if (r.flags & TREE_REDUCED)
+                reduced++;
+            if (r.flags & TREE_LMR_RESEARCH)
+                lmrResearches++;
+            if (r.flags & TREE_PVS_RESEARCH)
+                pvsResearches++;
+            if (r.flags & TREE_ASPIRATION_RESEARCH)
+                aspirationResearches++;
+            if (r.moveIndex > 0 && r.beta - r.alpha == 1 && !(r.flags & (TREE_LMR_RESEARCH | TREE_PVS_RESEARCH)))
+                scouts++;
+        }
+
+        PlyStats &operator+=(const PlyStats &other)
+        {
+            nodes += other.nodes;
+            ttCutoffs += other.ttCutoffs;
+            nodePrunes += other.nodePrunes;
+            expanded += other.expanded;
+            cutoffs += other.cutoffs;
+            cutoffIndexSum += other.cutoffIndexSum;
+            for (int b = 0; b < CUTOFF_BUCKETS; ++b)
+                cutoffBuckets[b] += other.cutoffBuckets[b];
+            futilityPrunes += other.futilityPrunes;
+            reduced += other.reduced;
+            lmrResearches += other.lmrResearches;
+            scouts += other.scouts;
+            pvsResearches += other.pvsResearches;
+            aspirationResearches += other.aspirationResearches;
+            nullMoves += other.nullMoves;
+            nullMoveCutoffs += other.nullMoveCutoffs;
+            return *this;
+        }
+    };
+
+    double percent(uint64_t part, uint64_t whole)
+    {
+        return whole ? 100.0 * static_cast<double>(part) / static_cast<double>(whole) : 0.0;
+    }
+
+    void printRow(const std::string &name, const PlyStats &s)
+    {
+        std::cout << std::setw(5) << name << std::setw(11) << s.nodes
+                  << std::setw(7) << percent(s.ttCutoffs, s.nodes)
+                  << std::setw(7) << percent(s.nodePrunes, s.nodes)
+                  << std::setw(7) << percent(s.cutoffs, s.expanded);
+        for (int b = 0; b < CUTOFF_BUCKETS; ++b)
+            std::cout << std::setw(7) << percent(s.cutoffBuckets[b], s.cutoffs);
+        std::cout << std::setw(7) << (s.cutoffs ? static_cast<double>(s.cutoffIndexSum) / s.cutoffs : 0.0)
+                  << std::setw(8) << percent(s.lmrResearches, s.reduced)
+                  << std::setw(8) << percent(s.pvsResearches, s.scouts) << "\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: chess_treelog <file> [rootDepth]\n";
+        return 1;
+    }
+    int rootDepth = argc > 2 ? std::atoi(argv[2]) : 0;
+
+    TreeLogReader reader;
+    std::string error;
+    if (!reader.open(argv[1], error))
+    {
+        std::cerr << error << "\n";
+        return 1;
+    }
+
+    std::vector<PlyStats> plies;
+    uint64_t records = 0;
+    TreeLogRecord record;
+    while (reader.next(record))
+    {
+        if (rootDepth > 0 && record.rootDepth != rootDepth)
+            continue;
+        records++;
+        if (plies.size() <= record.ply)
+            plies.resize(record.ply + 1);
+        plies[record.ply].add(record);
+    }
+
+    PlyStats total;
+    for (const PlyStats &s : plies)
+        total += s;
+
+    std::cout << "Records    : " << records << "\n";
+    if (rootDepth > 0)
+        std::cout << "Root depth : " << rootDepth << "\n";
+    std::cout << "\n"
+              << "Per ply (%; cut = beta cutoffs per expanded node, 1st..9+ = position of the cutoff move)\n"
+              << std::setw(5) << "ply" << std::setw(11) << "nodes" << std::setw(7) << "tt" << std::setw(7)
+              << "pruned" << std::setw(7) << "cut";
+    for (const char *name : CUTOFF_BUCKET_NAMES)
+        std::cout << std::setw(7) << name;
+    std::cout << std::setw(7) << "avgidx" << std::setw(8) << "lmr re" << std::setw(8) << "pvs re" << "\n";
+
+    std::cout << std::fixed << std::setprecision(1);
+    for (size_t ply = 0; ply < plies.size(); ++ply)
+        if (plies[ply].nodes > 0)
+            printRow(std::to_string(ply), plies[ply]);
+    printRow("all", total);
+
+    uint64_t moves = total.nodes - total.nullMoves + total.futilityPrunes;
+    std::cout << "\n"
+              << "Futility pruned : " << total.futilityPrunes << " moves (" << percent(total.futilityPrunes, moves)
+              << "% of moves)\n"
+              << "Null move       : " << total.nullMoves << " tries, " << total.nullMoveCutoffs << " cutoffs ("
+              << percent(total.nullMoveCutoffs, total.nullMoves) << "%)\n"
+              << "LMR             : " << total.reduced << " reduced, " << total.lmrResearches << " re-searched ("
+              << percent(total.lmrResearches, total.reduced) << "%)\n"
+              << "PVS             : " << total.scouts << " scouts, " << total.pvsResearches << " re-searched ("
+              << percent(total.pvsResearches, total.scouts) << "%)\n"
+              << "Aspiration      : " << total.aspirationResearches << " re-searches\n";
+    return 0;
+}